@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <SpscQueue.h>
+#include "Control.h"
+
+// Zone setting commands: parsed from MQTT messages on the network task,
+// applied whole on the control task, the only writer of zones[].
+//
+// Kept apart from the networking in main.cpp so the native simulator
+// changes settings through the same handlers and queue as the board.
+
+// ********************* Command Parameters ************************
+#define ZONE_COMMAND_QUEUE 32 /// Commands waiting for the control task
+#define BULK_ZONES_MAX 16     /// Zones one bulk command may name, other units' included
+
+// Zone setting changes from one message: a single zone's /set or /enable,
+// or any number of zones from the bulk topic. The control task applies a
+// command whole, in one pass.
+struct ZoneCommand
+{
+  uint32_t setTempMask; /// Zones whose setTemp is given
+  uint32_t enableMask;  /// Zones whose heatEnable is given
+  int16_t setTemp[ZONE_COUNT];
+  bool heatEnable[ZONE_COUNT];
+  bool bulk; /// From the bulk topic, answered with one full status
+};
+static_assert(ZONE_COUNT <= 32, "ZoneCommand masks hold 32 zones");
+
+extern SpscQueue<ZoneCommand, ZONE_COMMAND_QUEUE> zoneCommands; // Producer: MQTT callback, consumer: control task
+
+// Raised by applyZoneCommands() for the UI task
+extern std::atomic<bool> statusPublishPending;
+extern std::atomic<bool> bulkStatusPending; /// Full status that stands in for the zone deltas
+
+void queueZoneCommand(const ZoneCommand &cmd);
+void applyZoneCommands();
+
+// TopicRouter handlers; zone is the index the route was added with
+void onZonesSetMessage(const char *topic, char *msg, size_t len, intptr_t context);
+void onSetPointMessage(const char *topic, char *msg, size_t len, intptr_t zone);
+void onEnableMessage(const char *topic, char *msg, size_t len, intptr_t zone);
@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include "ZoneConfig.h"
+#include <ZoneSampler.h>
+#include <ThermistorTable.h>
+
+// Sensor sampling and the heating hysteresis.
+//
+// Kept apart from the tasks, networking and display in main.cpp so the
+// same code runs on the board and in the native simulator (src/sim).
+
+// ********************* Sampling Parameters ************************
+#define SAMPLE_DEPTH 16       /// Raw samples averaged per zone
+#define SAMPLE_PERIOD_MS 10   /// Time between ADC sweeps of all zones
+#define CONTROL_PERIOD_MS 100 /// Time between control loop passes
+#define MUX_SETTLE_US 20      /// Analog mux settling time after switching channel
+
+// Zone Data - pins, names and command topics all come from the board table
+inline constexpr ZoneTable<ZONE_COUNT> zoneTable(zoneDefs);
+
+// Core System Parameters - zones[] belongs to the control task
+extern ZoneState zones[ZONE_COUNT];
+extern ZoneSampler<ZONE_COUNT, SAMPLE_DEPTH> zoneSampler;
+
+// Alarms raised on the control task, published later from the UI task
+extern std::atomic<const char *> zoneAlarm[ZONE_COUNT];
+
+// Beta equation of the floor sensors, the benchmarks' reference
+extern const thermistor::BetaModel floorSensorModel;
+
+// Relay outputs. The default drives ZoneDef.outPin as a GPIO. A board table
+// that defines ZONE_RELAY_DRIVER drives them some other way (e.g. an I2C
+// expander, with outPin its channel) and supplies both functions itself.
+void zoneRelayBegin();
+void zoneRelayWrite(size_t i, bool on);
+
+void initZones();
+void turnOffHeating(int i);
+void raiseZoneAlarm(int zone, const char *message);
+float ConvertValToTemp(int Vo);
+void selectMuxChannel(int8_t channel);
+void sampleZones();
+void GetTemps();
+void SetHeatControl();
@@ -0,0 +1,19 @@
+#pragma once
+#include <Bench.h>
+
+// Benchmarks of the code that builds both on the board and natively. The
+// board adds the MQTT and display paths in main.cpp (FLOORTHERM_BENCH).
+
+// One message of the mixed stream replayed through the MQTT router
+struct BenchMessage
+{
+  const char *topic;
+  const char *payload;
+};
+
+// What the broker sends on floortherm/#: mostly status echoes from this
+// and other units, some zone commands and requests for other units
+extern const BenchMessage benchMessages[];
+extern const size_t benchMessageCount;
+
+void benchCore(Bench &bench);
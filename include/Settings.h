@@ -0,0 +1,30 @@
+#pragma once
+#include <atomic>
+#include <Preferences.h>
+#include "Control.h"
+
+// Settings persisted in NVS: zone set points and enables, the unit index
+// and the log level.
+//
+// Kept apart from the networking in main.cpp so the native simulator
+// stores and reloads them through the same code (NativeHal supplies an
+// in-memory Preferences).
+
+// ********************* Preference Parameters ************************
+#define PREFS_KEY "cfg"           /// NVS key holding the settings blob
+#define PREFS_VERSION 1           /// Bump when Settings changes layout
+#define PREFS_DEBOUNCE_MS 2000    /// Quiet time after the last change before writing
+#define PREFS_MAX_DELAY_MS 30000  /// Longest a change waits while changes keep coming
+
+extern Preferences preferences;
+
+extern int floorthermIndex;
+extern int logLevel;
+
+// Set by whoever changes a setting, picked up by servicePrefs()
+extern std::atomic<bool> prefsStorePending;
+extern uint32_t prefsFlashWrites;
+
+void storePrefs();
+void servicePrefs(unsigned long now);
+void loadPrefs();
@@ -0,0 +1,35 @@
+#pragma once
+#include <SeqLock.h>
+#include "Control.h"
+
+// Zone state as the other tasks see it, and the status JSON built from it.
+//
+// Kept apart from the networking in main.cpp so the host benchmarks
+// (src/bench) serialize the same documents the board publishes.
+
+// ********************* Status JSON Parameters ************************
+#define ROOM_JSON_MAX 96                                     /// {"CurrentTemp":-999.99,"Enabled":false,...} with headroom
+#define STATUS_JSON_MAX (ZONE_COUNT * (ROOM_JSON_MAX + 16) + 2) /// Zone name key per room plus braces
+
+// ********************* Status Publishing Parameters ************************
+#define STATUS_PUBLISH_DELTA         /// Publish per-zone status on change, full status only as a heartbeat
+#define STATUS_DEADBAND_F 0.2        /// Temperature change that counts as a zone status change
+#define STATUS_HEARTBEAT_MS 300000   /// Full status and zone republish period in delta mode
+#define STATUS_BROADCAST_MS 60000    /// Full status period without delta mode
+
+// zones[] belongs to the control task. Everyone else reads the published
+// snapshot and changes settings by queueing a command.
+struct ZoneSnapshot
+{
+  ZoneState zone[ZONE_COUNT];
+};
+
+extern SeqLock<ZoneSnapshot> zoneState;
+
+// Zone state the cached status JSON was built from (UI task only)
+extern ZoneSnapshot statusJsonState;
+
+void publishZoneState();
+size_t getRoomStatusJson(const ZoneState &zone, char *buf, size_t size);
+size_t getStatusJson(const ZoneSnapshot &zs, char *buf, size_t size);
+const char *cachedStatusJson(size_t &len);
@@ -0,0 +1,100 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// MQTT topics, and the routes incoming messages are dispatched through.
+//
+// setupTopicRoutes() in main.cpp builds its router from topicRoutes[] and
+// the router benchmark (src/bench) builds its own from the same table, so
+// the benchmark measures the routes the firmware really has. Both add the
+// per-zone /set and /enable topics from zoneTable (Zones.h) on top.
+
+#define TOPIC_ROUTES 128 /// Router hash table slots (power of two, kept under 3/4 full)
+
+// Published Topics
+constexpr const char *mainPubTopic = "floortherm/"; // Topic to publish
+constexpr const char *aliveTopic = "floortherm/online";
+constexpr const char *alarmTopic = "floortherm/alarm";
+constexpr const char *willTopic = "floortherm/offline";
+constexpr const char *statusTopic = "floortherm/status";
+constexpr const char *metricsTopic = "floortherm/sys/metrics";
+constexpr const char *controlMetricsTopic = "floortherm/sys/control";
+constexpr const char *logPubTopic = "floorthermlog/"; // + index; outside floortherm/# so we don't hear our own logs
+constexpr const char *historyPubTopic = "floorthermhist/"; // + index; query replies, read with scripts/history_decode.py
+constexpr const char *summaryPubTopic = "floorthermsum/";  // + index; summary replies, one JSON bucket per message
+constexpr const char *tracePubTopic = "floorthermtrace/";  // + index; trace dump, read with scripts/trace_to_chrome.py
+
+// Subscribed Topics
+constexpr const char *SubTopic = "floortherm/#";
+constexpr const char *setTempTopic = "floortherm/#/set";
+constexpr const char *enableHeatTopic = "floortherm/#/enable";
+constexpr const char *getStatusTopic = "floortherm/get";
+constexpr const char *zonesSetTopic = "floortherm/zones/set"; // {"<zone>":{"SetTemp":70,"Enabled":true},...}, JSON or MessagePack
+constexpr const char *displayOnTopic = "floortherm/sys/display/on";
+constexpr const char *displayOffTopic = "floortherm/sys/display/off";
+constexpr const char *logBinaryTopic = "floortherm/sys/log/binary";
+constexpr const char *logTextTopic = "floortherm/sys/log/text";
+constexpr const char *restartTopic = "floortherm/sys/restart";
+constexpr const char *historyGetTopic = "floortherm/sys/history/get"; // "<index> [from] [to]", epoch seconds
+constexpr const char *summaryGetTopic = "floortherm/sys/summary/get"; // "<index> <1|15|60 minutes> [count]"
+constexpr const char *metricsGetTopic = "floortherm/sys/metrics/get"; // "<index>", publishes metrics now
+constexpr const char *traceGetTopic = "floortherm/sys/trace/get";     // "<index> [serial]", dumps the scope trace
+constexpr const char *alarmPattern = "floortherm/alarm/#";
+constexpr const char *zoneStatusPattern = "floortherm/+/status";
+
+// What a route does; main.cpp maps each one to its handler
+enum class TopicAction : uint8_t
+{
+  Ignore, /// Our own or another unit's status, metrics or alarm
+  Alive,
+  Restart,
+  GetStatus,
+  ZonesSet,
+  Display,   /// Context: 1 on, 0 off
+  LogFormat, /// Context: 1 binary, 0 text
+  LogLevel,  /// Context: the level
+  HistoryGet,
+  SummaryGet,
+  MetricsGet,
+  TraceGet,
+  Count
+};
+
+struct TopicRouteDef
+{
+  const char *topic;
+  TopicAction action;
+  intptr_t context; /// Handed to the handler
+  bool pattern;     /// MQTT wildcard pattern, tried only when no exact topic matches
+};
+
+constexpr TopicRouteDef topicRoutes[] = {
+    {statusTopic, TopicAction::Ignore, 0, false},
+    {metricsTopic, TopicAction::Ignore, 0, false},
+    {controlMetricsTopic, TopicAction::Ignore, 0, false},
+    {willTopic, TopicAction::Ignore, 0, false},
+    {alarmTopic, TopicAction::Ignore, 0, false},
+    {alarmPattern, TopicAction::Ignore, 0, true},
+    {zoneStatusPattern, TopicAction::Ignore, 0, true},
+
+    {aliveTopic, TopicAction::Alive, 0, false},
+    {restartTopic, TopicAction::Restart, 0, false},
+    {getStatusTopic, TopicAction::GetStatus, 0, false},
+    {zonesSetTopic, TopicAction::ZonesSet, 0, false},
+    {displayOnTopic, TopicAction::Display, 1, false},
+    {displayOffTopic, TopicAction::Display, 0, false},
+    {logBinaryTopic, TopicAction::LogFormat, 1, false},
+    {logTextTopic, TopicAction::LogFormat, 0, false},
+    {historyGetTopic, TopicAction::HistoryGet, 0, false},
+    {summaryGetTopic, TopicAction::SummaryGet, 0, false},
+    {metricsGetTopic, TopicAction::MetricsGet, 0, false},
+    {traceGetTopic, TopicAction::TraceGet, 0, false},
+
+    // Context is the LOG_LEVEL_* value
+    {"floortherm/sys/log/silent", TopicAction::LogLevel, 0, false},
+    {"floortherm/sys/log/fatal", TopicAction::LogLevel, 1, false},
+    {"floortherm/sys/log/error", TopicAction::LogLevel, 2, false},
+    {"floortherm/sys/log/warning", TopicAction::LogLevel, 3, false},
+    {"floortherm/sys/log/info", TopicAction::LogLevel, 4, false},
+    {"floortherm/sys/log/trace", TopicAction::LogLevel, 5, false},
+    {"floortherm/sys/log/verbose", TopicAction::LogLevel, 6, false}};
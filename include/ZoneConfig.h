@@ -0,0 +1,68 @@
+#pragma once
+#include "Zones.h"
+
+// Per-board zone tables. Pick one with -D FLOORTHERM_ZONES=<n> (default 5).
+
+#ifndef FLOORTHERM_ZONES
+#define FLOORTHERM_ZONES 5
+#endif
+
+#if FLOORTHERM_ZONES == 5
+
+// Original board: every sensor on its own ADC1 pin, no mux
+#if defined(DEBUG_MODE)
+constexpr ZoneDef zoneDefs[] = {
+    {"ZNA", "Zone A", 32, -1, 16},
+    {"ZNB", "Zone B", 33, -1, 17},
+    {"ZNC", "Zone C", 34, -1, 18},
+    {"ZND", "Zone D", 35, -1, 19},
+    {"ZNE", "Zone E", 36, -1, 23}};
+#else
+constexpr ZoneDef zoneDefs[] = {
+    {"MBR", "Master Bedroom", 32, -1, 16},
+    {"NAV", "Narayan's Room", 33, -1, 17},
+    {"OFC", "Office", 34, -1, 18},
+    {"SMV", "Shanti's Room", 35, -1, 19},
+    {"MAV", "Maya's Room", 36, -1, 23}};
+#endif
+constexpr uint8_t muxSelectPins[] = {0};
+constexpr size_t muxSelectCount = 0;
+
+#elif FLOORTHERM_ZONES == 8
+
+// 8 sensors behind a CD4051 on ADC1 pin 36, select lines S0..S2. Relays
+// stay off the strapping pins (0, 2, 5, 12, 15), which set the boot mode.
+constexpr ZoneDef zoneDefs[] = {
+    {"ZNA", "Zone A", 36, 0, 16},
+    {"ZNB", "Zone B", 36, 1, 17},
+    {"ZNC", "Zone C", 36, 2, 18},
+    {"ZND", "Zone D", 36, 3, 19},
+    {"ZNE", "Zone E", 36, 4, 23},
+    {"ZNF", "Zone F", 36, 5, 4},
+    {"ZNG", "Zone G", 36, 6, 32},
+    {"ZNH", "Zone H", 36, 7, 13}};
+constexpr uint8_t muxSelectPins[] = {25, 26, 27};
+constexpr size_t muxSelectCount = 3;
+
+#elif FLOORTHERM_ZONES == 16
+
+// 16 sensors fit behind one CD74HC4067 (4 select lines), but 16 relays plus
+// the select lines exceed the free ESP32 GPIOs. Such a board needs a relay
+// expander, so it must supply its own table, define ZONE_RELAY_DRIVER there
+// and implement zoneRelayBegin() / zoneRelayWrite() (see Control.h).
+#if !defined(FLOORTHERM_ZONE_TABLE)
+#error "16-zone boards need a relay expander; provide -D FLOORTHERM_ZONE_TABLE=\"YourBoardZones.h\""
+#endif
+#include FLOORTHERM_ZONE_TABLE
+#if !defined(ZONE_RELAY_DRIVER)
+#error "16 relays don't fit on GPIOs; the zone table must define ZONE_RELAY_DRIVER"
+#endif
+
+#else
+#error "Unsupported FLOORTHERM_ZONES"
+#endif
+
+#define ZONE_COUNT (sizeof(zoneDefs) / sizeof(zoneDefs[0]))
+
+static_assert(ZONE_COUNT == FLOORTHERM_ZONES, "Zone table does not match FLOORTHERM_ZONES");
+static_assert(muxSelectCount == 0 || ZONE_COUNT <= (1u << muxSelectCount), "Not enough mux select lines for the zone count");
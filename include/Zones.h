@@ -0,0 +1,108 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Zone configuration and per-zone state, sized at compile time.
+//
+// Each board describes its zones once in ZoneConfig.h; the pins, names and the
+// MQTT command topics for every zone are all derived from that table by the
+// compiler, so there is no runtime String building and no hard-coded zone
+// count anywhere else.
+
+enum class HeatingMode : uint8_t
+{
+  Off,
+  Idle,
+  Heating
+};
+
+struct ZoneDef
+{
+  const char *name;         /// Short name, used on the display and in topics
+  const char *friendlyName; /// Human readable name
+  uint8_t inPin;            /// ADC pin (the mux common pin for muxed zones)
+  int8_t muxChannel;        /// Analog mux channel, or -1 when wired directly
+  uint8_t outPin;           /// Relay GPIO, or channel on a ZONE_RELAY_DRIVER board
+};
+
+// Packed per-zone runtime state, one cache-friendly record per zone
+struct ZoneState
+{
+  float actualTemp;
+  uint16_t readVal;
+  int16_t setTemp;
+  bool heatEnable;
+  bool heating;
+  HeatingMode mode;
+};
+
+#define TOPIC_MAX_LEN 48
+
+struct TopicString
+{
+  char str[TOPIC_MAX_LEN];
+
+  constexpr const char *c_str() const { return str; }
+};
+
+// Not defined anywhere: reaching it during constant evaluation turns an
+// over-long topic into a compile error.
+void zoneTopicTooLong();
+
+constexpr TopicString makeTopic(const char *prefix, const char *name, const char *suffix)
+{
+  TopicString t{};
+  const char *parts[] = {prefix, name, suffix};
+  size_t n = 0;
+  for (const char *p : parts)
+  {
+    for (; *p != '\0'; p++)
+    {
+      if (n >= TOPIC_MAX_LEN - 1)
+        zoneTopicTooLong();
+      t.str[n++] = *p;
+    }
+  }
+  t.str[n] = '\0';
+  return t;
+}
+
+template <size_t N>
+struct ZoneTable
+{
+  ZoneDef def[N];
+  TopicString setPointTopic[N];
+  TopicString enableTopic[N];
+  TopicString alarmTopic[N];
+  TopicString statusTopic[N];
+
+  constexpr explicit ZoneTable(const ZoneDef (&defs)[N])
+      : def{}, setPointTopic{}, enableTopic{}, alarmTopic{}, statusTopic{}
+  {
+    for (size_t i = 0; i < N; i++)
+    {
+      def[i] = defs[i];
+      setPointTopic[i] = makeTopic("floortherm/", defs[i].name, "/set");
+      enableTopic[i] = makeTopic("floortherm/", defs[i].name, "/enable");
+      alarmTopic[i] = makeTopic("floortherm/alarm/", defs[i].name, "");
+      statusTopic[i] = makeTopic("floortherm/", defs[i].name, "/status");
+    }
+  }
+
+  constexpr const char *name(size_t i) const { return def[i].name; }
+
+  /**
+   * \return index of the zone with this short name, -1 if it isn't ours
+   */
+  int indexOf(const char *zoneName) const
+  {
+    for (size_t i = 0; i < N; i++)
+    {
+      if (strcmp(def[i].name, zoneName) == 0)
+        return i;
+    }
+    return -1;
+  }
+  static constexpr size_t size() { return N; }
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+/**
+ * Running min / max / mean temperature and heating duty for one zone.
+ * add() and merge() are O(1) and it never allocates.
+ */
+struct AggregateStats
+{
+    float min;
+    float max;
+    float sum;
+    uint32_t tempSamples; /// Samples with a usable temperature
+    uint32_t samples;     /// All samples, the duty cycle base
+    uint32_t heating;     /// Samples spent heating
+
+    void reset()
+    {
+        min = INFINITY;
+        max = -INFINITY;
+        sum = 0;
+        tempSamples = 0;
+        samples = 0;
+        heating = 0;
+    }
+
+    /**
+     * \param temp - zone temperature
+     * \param tempValid - false for a sensor fault, only the heating state counts
+     * \param isHeating - zone relay state
+     */
+    void add(float temp, bool tempValid, bool isHeating)
+    {
+        if (tempValid)
+        {
+            min = fminf(min, temp);
+            max = fmaxf(max, temp);
+            sum += temp;
+            tempSamples++;
+        }
+        samples++;
+        heating += isHeating;
+    }
+
+    void merge(const AggregateStats &o)
+    {
+        min = fminf(min, o.min);
+        max = fmaxf(max, o.max);
+        sum += o.sum;
+        tempSamples += o.tempSamples;
+        samples += o.samples;
+        heating += o.heating;
+    }
+
+    float mean() const { return tempSamples ? sum / tempSamples : NAN; }
+
+    /**
+     * \return fraction of samples spent heating, 0..1
+     */
+    float duty() const { return samples ? (float)heating / samples : 0; }
+};
+
+/**
+ * Aggregates of every zone over one period starting at start.
+ */
+template <size_t Zones>
+struct AggregateBucket
+{
+    uint32_t start; /// Epoch seconds
+    AggregateStats zone[Zones];
+
+    void reset(uint32_t at)
+    {
+        start = at;
+        for (size_t i = 0; i < Zones; i++)
+            zone[i].reset();
+    }
+
+    bool empty() const { return zone[0].samples == 0; }
+};
+
+/**
+ * Compact stored form of one zone's aggregates.
+ */
+struct AggregateSummary
+{
+    int16_t min;  /// Tenths of a degree, INT16_MIN if there were no readings
+    int16_t max;
+    int16_t mean;
+    uint8_t duty; /// Percent of the period spent heating
+
+    static int16_t tenths(float t) { return isfinite(t) ? (int16_t)lroundf(t * 10) : INT16_MIN; }
+
+    static AggregateSummary of(const AggregateStats &s)
+    {
+        AggregateSummary a;
+        a.min = tenths(s.min);
+        a.max = tenths(s.max);
+        a.mean = tenths(s.mean());
+        a.duty = (uint8_t)lroundf(s.duty() * 100);
+        return a;
+    }
+};
+
+/**
+ * Builds the finest (base) buckets from raw samples. Feed it every
+ * control pass; it hands back the finished bucket whenever the clock
+ * moves into the next period.
+ */
+template <size_t Zones>
+class AggregateSampler
+{
+public:
+    explicit AggregateSampler(uint32_t periodS) : _periodS(periodS) { _bucket.reset(0); }
+
+    /**
+     * Starts a new bucket if now is in a later period than the current one.
+     * \param now - epoch seconds
+     * \param done - receives the finished bucket
+     * \return true if done was filled in
+     */
+    bool roll(uint32_t now, AggregateBucket<Zones> &done)
+    {
+        uint32_t start = now - now % _periodS;
+        if (start == _bucket.start)
+            return false;
+
+        bool finished = !_bucket.empty();
+        if (finished)
+            done = _bucket;
+        _bucket.reset(start);
+        return finished;
+    }
+
+    void add(size_t zone, float temp, bool tempValid, bool heating) { _bucket.zone[zone].add(temp, tempValid, heating); }
+
+private:
+    uint32_t _periodS;
+    AggregateBucket<Zones> _bucket;
+};
+
+/**
+ * One resolution: merges base buckets into periodS buckets and keeps the
+ * last Depth finished ones. A bucket is finished by the base bucket that
+ * ends its period, or, if that one went missing, by the first base bucket
+ * of a later period.
+ */
+template <size_t Zones, size_t Depth>
+class AggregateLevel
+{
+public:
+    explicit AggregateLevel(uint32_t periodS) : _periodS(periodS), _written(0) { _bucket.reset(0); }
+
+    /**
+     * \param b - finished base bucket
+     * \param baseS - base bucket period
+     */
+    void add(const AggregateBucket<Zones> &b, uint32_t baseS)
+    {
+        uint32_t start = b.start - b.start % _periodS;
+        if (start != _bucket.start)
+        {
+            if (!_bucket.empty())
+                store(_bucket);
+            _bucket.reset(start);
+        }
+        for (size_t i = 0; i < Zones; i++)
+            _bucket.zone[i].merge(b.zone[i]);
+
+        if ((b.start + baseS) % _periodS == 0)
+        {
+            store(_bucket);
+            _bucket.reset(0);
+        }
+    }
+
+    uint32_t periodS() const { return _periodS; }
+
+    /**
+     * \return buckets finished since boot; serials below written() - Depth
+     *         have been overwritten
+     */
+    uint32_t written() const { return _written; }
+
+    /**
+     * \return serial of the oldest bucket still held
+     */
+    uint32_t oldest() const { return _written > Depth ? _written - Depth : 0; }
+
+    uint32_t start(uint32_t serial) const { return _start[serial % Depth]; }
+
+    const AggregateSummary &summary(uint32_t serial, size_t zone) const { return _summary[serial % Depth][zone]; }
+
+private:
+    void store(const AggregateBucket<Zones> &b)
+    {
+        size_t slot = _written % Depth;
+        _start[slot] = b.start;
+        for (size_t i = 0; i < Zones; i++)
+            _summary[slot][i] = AggregateSummary::of(b.zone[i]);
+        _written++;
+    }
+
+    uint32_t _periodS;
+    uint32_t _written;
+    AggregateBucket<Zones> _bucket;
+    uint32_t _start[Depth];
+    AggregateSummary _summary[Depth][Zones];
+};
@@ -0,0 +1,106 @@
+#include "AllocCounter.h"
+
+#include <atomic>
+#include <stdlib.h>
+
+#ifdef ALLOC_COUNTER
+
+namespace
+{
+    std::atomic<TaskHandle_t> watched[ALLOC_COUNTER_TASKS];
+    std::atomic<uint32_t> counts[ALLOC_COUNTER_TASKS];
+    std::atomic<uint32_t> total(0);
+
+    void countAlloc()
+    {
+        total.fetch_add(1, std::memory_order_relaxed);
+
+        // Before the scheduler runs there is no current task to match
+        if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)
+            return;
+
+        TaskHandle_t self = xTaskGetCurrentTaskHandle();
+        for (size_t i = 0; i < ALLOC_COUNTER_TASKS; i++)
+        {
+            if (watched[i].load(std::memory_order_relaxed) == self)
+            {
+                counts[i].fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+}
+
+extern "C"
+{
+    void *__real_malloc(size_t size);
+    void *__real_calloc(size_t n, size_t size);
+    void *__real_realloc(void *ptr, size_t size);
+
+    void *__wrap_malloc(size_t size)
+    {
+        countAlloc();
+        return __real_malloc(size);
+    }
+
+    void *__wrap_calloc(size_t n, size_t size)
+    {
+        countAlloc();
+        return __real_calloc(n, size);
+    }
+
+    void *__wrap_realloc(void *ptr, size_t size)
+    {
+        // String growth lands here, so count it like a fresh allocation
+        countAlloc();
+        return __real_realloc(ptr, size);
+    }
+}
+
+bool allocCounterWatch(TaskHandle_t task)
+{
+    for (size_t i = 0; i < ALLOC_COUNTER_TASKS; i++)
+    {
+        TaskHandle_t expected = NULL;
+        if (watched[i].compare_exchange_strong(expected, task))
+        {
+            counts[i] = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t allocCount(TaskHandle_t task)
+{
+    for (size_t i = 0; i < ALLOC_COUNTER_TASKS; i++)
+    {
+        if (watched[i].load(std::memory_order_relaxed) == task)
+            return counts[i].load(std::memory_order_relaxed);
+    }
+    return 0;
+}
+
+uint32_t allocCountTotal()
+{
+    return total.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool allocCounterWatch(TaskHandle_t task)
+{
+    return false;
+}
+
+uint32_t allocCount(TaskHandle_t task)
+{
+    return 0;
+}
+
+uint32_t allocCountTotal()
+{
+    return 0;
+}
+
+#endif
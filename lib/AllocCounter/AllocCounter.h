@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+extern "C"
+{
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+}
+
+#ifndef ALLOC_COUNTER_TASKS
+#define ALLOC_COUNTER_TASKS 8 /// Tasks whose heap allocations can be counted
+#endif
+
+/**
+ * Counts heap allocations made by selected FreeRTOS tasks.
+ *
+ * Counting is only compiled in with ALLOC_COUNTER defined, and needs the
+ * allocator wrapped at link time:
+ *
+ *   build_flags = -DALLOC_COUNTER -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc
+ *
+ * Without it every count stays at zero. Wrapping covers String, new (which
+ * calls malloc) and library code alike.
+ */
+
+/**
+ * Starts counting allocations made by a task.
+ * \param task - the task to watch
+ * \return false if the table is full or counting is not compiled in
+ */
+bool allocCounterWatch(TaskHandle_t task);
+
+/**
+ * \param task - a watched task
+ * \return allocations the task has made since it was watched
+ */
+uint32_t allocCount(TaskHandle_t task);
+
+/**
+ * \return allocations made by all tasks since boot
+ */
+uint32_t allocCountTotal();
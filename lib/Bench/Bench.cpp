@@ -0,0 +1,92 @@
+#include "Bench.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Esp.h>
+
+BenchTicks benchTicks()
+{
+    return ESP.getCycleCount();
+}
+
+double benchTicksToNs(BenchTicks ticks)
+{
+    return ticks * 1000.0 / ESP.getCpuFreqMHz();
+}
+
+bool benchCountsCycles()
+{
+    return true;
+}
+
+#else
+
+#include <chrono>
+
+BenchTicks benchTicks()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+double benchTicksToNs(BenchTicks ticks)
+{
+    return ticks;
+}
+
+bool benchCountsCycles()
+{
+    return false;
+}
+
+#endif
+
+void Bench::begin()
+{
+    char line[128];
+    snprintf(line, sizeof(line), "%-32s %8s %12s %12s %12s %12s %10s\n", "benchmark", "ops", "ops/s", "ns/op", "max ns",
+             "cycles/op", "allocs/op");
+    _out->print(line);
+}
+
+void Bench::skip(const char *name, const char *reason)
+{
+    char line[128];
+    snprintf(line, sizeof(line), "%-32s skipped: %s\n", name, reason);
+    _out->print(line);
+}
+
+void Bench::note(const char *name, const char *format, ...)
+{
+    char text[96];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    char line[128];
+    snprintf(line, sizeof(line), "%-32s %s\n", name, text);
+    _out->print(line);
+}
+
+void Bench::report(const char *name, uint32_t ops, BenchTicks elapsed, uint32_t allocs, BenchTicks worst)
+{
+    double ns = benchTicksToNs(elapsed) / ops;
+
+    char cycles[16] = "-";
+    if (benchCountsCycles())
+        snprintf(cycles, sizeof(cycles), "%.1f", (double)elapsed / ops);
+
+    char max[16] = "-";
+    if (worst > 0)
+        snprintf(max, sizeof(max), "%.1f", benchTicksToNs(worst));
+
+    char line[128];
+    snprintf(line, sizeof(line), "%-32s %8lu %12.0f %12.1f %12s %12s %10.2f\n", name, (unsigned long)ops,
+             ns > 0 ? 1e9 / ns : 0.0, ns, max, cycles, (double)allocs / ops);
+    _out->print(line);
+}
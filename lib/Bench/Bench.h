@@ -0,0 +1,162 @@
+#pragma once
+
+#include <Print.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <AllocCounter.h>
+
+/**
+ * Elapsed time for benchmarks: the CPU cycle counter on the ESP32, a
+ * nanosecond clock on the host.
+ *
+ * The ESP32 counter is 32 bits and wraps after 2^32 cycles (about 17 s at
+ * 240 MHz), so a single run() has to finish inside that.
+ */
+#ifdef ARDUINO_ARCH_ESP32
+typedef uint32_t BenchTicks;
+#else
+typedef uint64_t BenchTicks;
+#endif
+
+BenchTicks benchTicks();
+
+/**
+ * \return nanoseconds in ticks
+ */
+double benchTicksToNs(BenchTicks ticks);
+
+/**
+ * \return true if ticks are CPU cycles
+ */
+bool benchCountsCycles();
+
+/**
+ * Stops the compiler dropping a result nothing reads.
+ */
+template <typename T>
+inline void benchKeep(const T &value)
+{
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+/**
+ * Print that throws everything away, for timing formatting without the
+ * output behind it.
+ */
+class BenchSink : public Print
+{
+public:
+    BenchSink() : _bytes(0) {}
+
+    size_t write(uint8_t c) override
+    {
+        _bytes++;
+        return 1;
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        _bytes += size;
+        return size;
+    }
+
+    using Print::write;
+
+    size_t bytes() const { return _bytes; }
+
+private:
+    size_t _bytes;
+};
+
+/**
+ * Runs micro benchmarks and prints one line per benchmark: operations per
+ * second, time per operation, the slowest single operation (runEach()
+ * only), CPU cycles per operation (ESP32 only) and heap allocations per
+ * operation.
+ *
+ * Allocations come from allocCountTotal(), so they are only counted with
+ * ALLOC_COUNTER and the allocator wrapped (see AllocCounter.h), and they
+ * include anything another task allocates while a benchmark runs.
+ */
+class Bench
+{
+public:
+    explicit Bench(Print *out) : _out(out) {}
+
+    /**
+     * Prints the column headings.
+     */
+    void begin();
+
+    /**
+     * Calls fn once to warm up, then times ops more calls.
+     * \param name - benchmark name, up to 31 characters
+     * \param ops - calls to time
+     * \param fn - the operation
+     */
+    template <typename Fn>
+    void run(const char *name, uint32_t ops, Fn fn)
+    {
+        // First calls fill caches and make one-off allocations
+        fn();
+
+        uint32_t allocs = allocCountTotal();
+        BenchTicks start = benchTicks();
+        for (uint32_t i = 0; i < ops; i++)
+            fn();
+        BenchTicks elapsed = benchTicks() - start;
+        allocs = allocCountTotal() - allocs;
+
+        report(name, ops, elapsed, allocs);
+    }
+
+    /**
+     * Like run(), but times each call on its own so the slowest one can be
+     * reported too. Reading the clock around every call adds its own cost
+     * to each figure, so use run() when only the mean matters.
+     */
+    template <typename Fn>
+    void runEach(const char *name, uint32_t ops, Fn fn)
+    {
+        fn();
+
+        uint32_t allocs = allocCountTotal();
+        BenchTicks elapsed = 0;
+        BenchTicks worst = 0;
+        for (uint32_t i = 0; i < ops; i++)
+        {
+            BenchTicks start = benchTicks();
+            fn();
+            BenchTicks ticks = benchTicks() - start;
+            elapsed += ticks;
+            if (ticks > worst)
+                worst = ticks;
+        }
+        allocs = allocCountTotal() - allocs;
+
+        report(name, ops, elapsed, allocs, worst);
+    }
+
+    /**
+     * Prints a result line for operations timed by the caller, e.g. spread
+     * over several threads.
+     * \param elapsed - total time of the ops
+     * \param worst - slowest single op, 0 if not known
+     */
+    void report(const char *name, uint32_t ops, BenchTicks elapsed, uint32_t allocs, BenchTicks worst = 0);
+
+    /**
+     * Prints a figure that isn't a time, e.g. an error or a size, printf
+     * style after the name.
+     */
+    void note(const char *name, const char *format, ...);
+
+    /**
+     * Prints a line for a benchmark that can't run here.
+     */
+    void skip(const char *name, const char *reason);
+
+private:
+    Print *_out;
+};
@@ -0,0 +1,92 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+/**
+ * Single-writer, multi-reader sequence lock around a trivially copyable value.
+ *
+ * The writer never blocks and readers never take a lock: a reader copies the
+ * value and retries if the sequence number moved underneath it. The payload is
+ * held as relaxed atomic words so a torn read is detected rather than being a
+ * data race.
+ *
+ * The sequence number doubles as a version: it changes on every write, so
+ * consumers can cheaply tell whether anything was published since they last
+ * looked.
+ */
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock payload must be trivially copyable");
+
+public:
+    SeqLock() : _seq(0)
+    {
+        for (size_t i = 0; i < Words; i++)
+            _words[i].store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * Publish a new value. Only one task may ever call this.
+     */
+    void write(const T &value)
+    {
+        uint32_t buf[Words] = {};
+        memcpy(buf, &value, sizeof(T));
+
+        uint32_t seq = _seq.load(std::memory_order_relaxed);
+        _seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < Words; i++)
+            _words[i].store(buf[i], std::memory_order_relaxed);
+
+        _seq.store(seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * Copy out a consistent value. Safe from any task; never blocks the writer.
+     *
+     * \return the version the copy belongs to
+     */
+    uint32_t read(T &out) const
+    {
+        uint32_t buf[Words];
+        uint32_t before, after;
+        do
+        {
+            before = _seq.load(std::memory_order_acquire);
+            for (size_t i = 0; i < Words; i++)
+                buf[i] = _words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = _seq.load(std::memory_order_relaxed);
+        } while ((before & 1) || (before != after));
+
+        memcpy(&out, buf, sizeof(T));
+        return before >> 1;
+    }
+
+    T read() const
+    {
+        T out;
+        read(out);
+        return out;
+    }
+
+    /**
+     * Number of completed writes.
+     */
+    uint32_t version() const
+    {
+        return _seq.load(std::memory_order_acquire) >> 1;
+    }
+
+private:
+    static constexpr size_t Words = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> _seq;
+    std::atomic<uint32_t> _words[Words];
+};
@@ -0,0 +1,141 @@
+#include "DirtySSD1306.h"
+
+// Same chunking as Adafruit_SSD1306 so the byte counts line up
+#if defined(I2C_BUFFER_LENGTH)
+#define DIRTY_WIRE_MAX ((I2C_BUFFER_LENGTH) < 256 ? (I2C_BUFFER_LENGTH) : 256)
+#elif defined(BUFFER_LENGTH)
+#define DIRTY_WIRE_MAX ((BUFFER_LENGTH) < 256 ? (BUFFER_LENGTH) : 256)
+#else
+#define DIRTY_WIRE_MAX 32
+#endif
+
+DirtySSD1306::DirtySSD1306(uint8_t w, uint8_t h, TwoWire *twi, int8_t rst_pin,
+                           uint32_t clkDuring, uint32_t clkAfter)
+    : Adafruit_SSD1306(w, h, twi, rst_pin, clkDuring, clkAfter)
+{
+  for (uint8_t p = 0; p < MaxPages; p++)
+  {
+    dirtyStart[p] = 0xFF;
+    dirtyEnd[p] = 0;
+  }
+}
+
+void DirtySSD1306::markDirty(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  // Clip to the panel
+  if (x < 0)
+  {
+    w += x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    h += y;
+    y = 0;
+  }
+  if (x + w > WIDTH)
+    w = WIDTH - x;
+  if (y + h > HEIGHT)
+    h = HEIGHT - y;
+  if ((w <= 0) || (h <= 0))
+    return;
+
+  uint8_t x0 = x;
+  uint8_t x1 = x + w - 1;
+  uint8_t lastPage = (y + h - 1) / 8;
+  if (lastPage >= MaxPages)
+    lastPage = MaxPages - 1;
+
+  for (uint8_t p = y / 8; p <= lastPage; p++)
+  {
+    if (x0 < dirtyStart[p])
+      dirtyStart[p] = x0;
+    if (x1 > dirtyEnd[p])
+      dirtyEnd[p] = x1;
+  }
+}
+
+void DirtySSD1306::markAllDirty()
+{
+  markDirty(0, 0, WIDTH, HEIGHT);
+}
+
+bool DirtySSD1306::isDirty() const
+{
+  for (uint8_t p = 0; p < MaxPages; p++)
+  {
+    if (dirtyStart[p] <= dirtyEnd[p])
+      return true;
+  }
+  return false;
+}
+
+size_t DirtySSD1306::dataBytes(size_t count)
+{
+  // One 0x40 control byte opens each chunk of display data
+  return count + (count + DIRTY_WIRE_MAX - 2) / (DIRTY_WIRE_MAX - 1);
+}
+
+size_t DirtySSD1306::fullFrameBytes() const
+{
+  // PAGEADDR/COLUMNADDR list, the trailing column command, then the frame
+  return (1 + 5) + 2 + dataBytes(WIDTH * ((HEIGHT + 7) / 8));
+}
+
+size_t DirtySSD1306::sendSpan(uint8_t page, uint8_t start, uint8_t end)
+{
+  const uint8_t window[] = {SSD1306_PAGEADDR, page, page, SSD1306_COLUMNADDR, start, end};
+  ssd1306_commandList(window, sizeof(window));
+
+  const uint8_t *ptr = buffer + (size_t)page * WIDTH + start;
+  size_t count = end - start + 1;
+
+  wire->beginTransmission(i2caddr);
+  wire->write((uint8_t)0x40);
+  uint16_t bytesOut = 1;
+  for (size_t i = 0; i < count; i++)
+  {
+    if (bytesOut >= DIRTY_WIRE_MAX)
+    {
+      wire->endTransmission();
+      wire->beginTransmission(i2caddr);
+      wire->write((uint8_t)0x40);
+      bytesOut = 1;
+    }
+    wire->write(*ptr++);
+    bytesOut++;
+  }
+  wire->endTransmission();
+
+  return 1 + sizeof(window) + dataBytes(count);
+}
+
+size_t DirtySSD1306::displayDirty()
+{
+  if (!wire || !buffer)
+    return displayFull();
+
+  size_t sent = 0;
+  wire->setClock(wireClk);
+  for (uint8_t p = 0; p < MaxPages; p++)
+  {
+    if (dirtyStart[p] <= dirtyEnd[p])
+      sent += sendSpan(p, dirtyStart[p], dirtyEnd[p]);
+    dirtyStart[p] = 0xFF;
+    dirtyEnd[p] = 0;
+  }
+  wire->setClock(restoreClk);
+
+  return sent;
+}
+
+size_t DirtySSD1306::displayFull()
+{
+  display();
+  for (uint8_t p = 0; p < MaxPages; p++)
+  {
+    dirtyStart[p] = 0xFF;
+    dirtyEnd[p] = 0;
+  }
+  return fullFrameBytes();
+}
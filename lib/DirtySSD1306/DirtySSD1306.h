@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Adafruit_SSD1306.h>
+
+/**
+ * SSD1306 driver that only pushes the parts of the framebuffer that were
+ * marked as changed.
+ *
+ * Drawing works exactly as with Adafruit_SSD1306. The caller marks the
+ * rectangles it redrew with markDirty(), and displayDirty() then sends
+ * only the dirty column span of each touched 8-pixel page instead of the
+ * whole 1 KB frame. I2C only - on SPI panels displayDirty() falls back to
+ * a full display().
+ */
+class DirtySSD1306 : public Adafruit_SSD1306
+{
+public:
+  DirtySSD1306(uint8_t w, uint8_t h, TwoWire *twi, int8_t rst_pin = -1,
+               uint32_t clkDuring = 400000UL, uint32_t clkAfter = 100000UL);
+
+  /**
+   * Marks a rectangle as changed since the last push.
+   */
+  void markDirty(int16_t x, int16_t y, int16_t w, int16_t h);
+
+  /**
+   * Marks the whole panel as changed.
+   */
+  void markAllDirty();
+
+  /**
+   * \return true if anything is waiting to be pushed
+   */
+  bool isDirty() const;
+
+  /**
+   * Pushes the dirty spans to the panel and clears the dirty state.
+   * \return the number of bytes written to the bus, excluding addressing
+   */
+  size_t displayDirty();
+
+  /**
+   * Pushes the whole framebuffer with display() and clears the dirty state.
+   * \return the number of bytes written to the bus, excluding addressing
+   */
+  size_t displayFull();
+
+  /**
+   * \return the bus bytes a full display() costs for this panel
+   */
+  size_t fullFrameBytes() const;
+
+private:
+  static const uint8_t MaxPages = 8; /// 64 pixel rows
+
+  size_t sendSpan(uint8_t page, uint8_t start, uint8_t end);
+  static size_t dataBytes(size_t count);
+
+  uint8_t dirtyStart[MaxPages]; /// First dirty column in each page
+  uint8_t dirtyEnd[MaxPages];   /// Last dirty column, less than dirtyStart when clean
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef HISTORY_BLOCK_BYTES
+#define HISTORY_BLOCK_BYTES 512 /// One compressed block, the unit kept in RAM, written to flash and sent on MQTT
+#endif
+
+#define HISTORY_BLOCK_VERSION 1
+
+/**
+ * Block header, little endian, at the start of every block.
+ *
+ * Each block decodes on its own: the first sample is stored in full and
+ * the rest as deltas against the sample before, so a query can send any
+ * block without the ones around it. See scripts/history_decode.py.
+ *
+ *   first sample   zigzag varint  time delta (from firstTime, so 0)
+ *                  zigzag varint  temp per zone, tenths of a degree F
+ *                  zigzag varint  setTemp per zone
+ *                  bitmap         heating, one bit per zone
+ *   later samples  zigzag varint  time delta minus the previous delta
+ *                  zigzag varint  temp change per zone
+ *                  bitmap         zones whose setTemp changed
+ *                  zigzag varint  setTemp change, changed zones only
+ *                  bitmap         heating
+ *
+ * With a steady one minute period and slowly moving floors a sample is
+ * about one byte per zone plus two bitmaps.
+ */
+struct HistoryBlockHeader
+{
+    uint8_t version;    /// HISTORY_BLOCK_VERSION
+    uint8_t zones;      /// Zones per sample
+    uint16_t count;     /// Samples in the block
+    uint16_t used;      /// Payload bytes after the header
+    uint16_t reserved;
+    uint32_t firstTime; /// Epoch seconds of the first sample
+    uint32_t lastTime;  /// Epoch seconds of the last sample
+};
+
+static_assert(sizeof(HistoryBlockHeader) == 16, "History block header is part of the storage format");
+
+/**
+ * One history sample for every zone.
+ */
+template <size_t Zones>
+struct HistorySample
+{
+    uint32_t time;          /// Epoch seconds
+    int16_t temp[Zones];    /// Tenths of a degree F
+    int16_t setTemp[Zones]; /// Degrees F
+    bool heating[Zones];
+};
+
+/**
+ * \return true if the block holds samples from the from..to range (inclusive)
+ */
+inline bool historyBlockOverlaps(const uint8_t *block, uint32_t from, uint32_t to)
+{
+    HistoryBlockHeader h;
+    memcpy(&h, block, sizeof(h));
+    return (h.version == HISTORY_BLOCK_VERSION) && (h.count > 0) && (h.lastTime >= from) && (h.firstTime <= to);
+}
+
+/**
+ * Compresses samples into one block at a time.
+ *
+ * append() fails once the next sample doesn't fit; the caller takes the
+ * full block from data(), stores it and calls reset() before retrying.
+ */
+template <size_t Zones>
+class HistoryBlockWriter
+{
+    static_assert(Zones > 0 && Zones < 256, "Zone count must fit the block header");
+
+    static const size_t BitmapBytes = (Zones + 7) / 8;
+    static const size_t MaxSampleBytes = 5 + 3 * Zones + BitmapBytes + 3 * Zones + BitmapBytes;
+
+public:
+    HistoryBlockWriter() { reset(); }
+
+    /**
+     * Starts a new, empty block.
+     */
+    void reset()
+    {
+        memset(_block, 0, sizeof(_block));
+        _header = HistoryBlockHeader{HISTORY_BLOCK_VERSION, (uint8_t)Zones, 0, 0, 0, 0, 0};
+        _lastDelta = 0;
+        store();
+    }
+
+    /**
+     * Adds a sample. Samples must be in time order.
+     * \return false if the block is full and the sample was not added
+     */
+    bool append(const HistorySample<Zones> &s)
+    {
+        uint8_t buf[MaxSampleBytes];
+        uint8_t *p = buf;
+
+        if (_header.count == 0)
+        {
+            p = putSigned(p, 0);
+            for (size_t i = 0; i < Zones; i++)
+                p = putSigned(p, s.temp[i]);
+            for (size_t i = 0; i < Zones; i++)
+                p = putSigned(p, s.setTemp[i]);
+            p = putBitmap(p, s.heating);
+        }
+        else
+        {
+            int32_t delta = (int32_t)(s.time - _last.time);
+            p = putSigned(p, delta - _lastDelta);
+            for (size_t i = 0; i < Zones; i++)
+                p = putSigned(p, s.temp[i] - _last.temp[i]);
+
+            bool changed[Zones];
+            for (size_t i = 0; i < Zones; i++)
+                changed[i] = s.setTemp[i] != _last.setTemp[i];
+            p = putBitmap(p, changed);
+            for (size_t i = 0; i < Zones; i++)
+                if (changed[i])
+                    p = putSigned(p, s.setTemp[i] - _last.setTemp[i]);
+            p = putBitmap(p, s.heating);
+        }
+
+        size_t len = p - buf;
+        if (sizeof(HistoryBlockHeader) + _header.used + len > HISTORY_BLOCK_BYTES)
+            return false;
+
+        memcpy(_block + sizeof(HistoryBlockHeader) + _header.used, buf, len);
+        if (_header.count == 0)
+            _header.firstTime = s.time;
+        else
+            _lastDelta = (int32_t)(s.time - _last.time);
+        _header.used += len;
+        _header.count++;
+        _header.lastTime = s.time;
+        _last = s;
+        store();
+        return true;
+    }
+
+    bool empty() const { return _header.count == 0; }
+
+    const HistoryBlockHeader &header() const { return _header; }
+
+    /**
+     * \return the block, always HISTORY_BLOCK_BYTES long
+     */
+    const uint8_t *data() const { return _block; }
+
+private:
+    void store() { memcpy(_block, &_header, sizeof(_header)); }
+
+    static uint8_t *putSigned(uint8_t *p, int32_t v)
+    {
+        uint32_t u = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+        while (u >= 0x80)
+        {
+            *p++ = (uint8_t)(u | 0x80);
+            u >>= 7;
+        }
+        *p++ = (uint8_t)u;
+        return p;
+    }
+
+    static uint8_t *putBitmap(uint8_t *p, const bool (&bits)[Zones])
+    {
+        memset(p, 0, BitmapBytes);
+        for (size_t i = 0; i < Zones; i++)
+            if (bits[i])
+                p[i / 8] |= 1 << (i % 8);
+        return p + BitmapBytes;
+    }
+
+    uint8_t _block[HISTORY_BLOCK_BYTES];
+    HistoryBlockHeader _header;
+    HistorySample<Zones> _last;
+    int32_t _lastDelta;
+};
@@ -0,0 +1,152 @@
+// Flash only; the host benchmarks use HistoryBlock.h alone
+#if defined(ARDUINO_ARCH_ESP32)
+
+#include "HistorySegments.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+HistorySegments::HistorySegments(fs::FS &fs, const char *dir, uint16_t blocksPerSegment, uint16_t maxSegments)
+    : _fs(fs),
+      _dir(dir),
+      _blocksPerSegment(blocksPerSegment),
+      _maxSegments(maxSegments),
+      _ready(false),
+      _firstSegment(0),
+      _lastSegment(0),
+      _lastBlocks(0)
+{
+}
+
+bool HistorySegments::begin()
+{
+    _ready = false;
+    if (!_fs.exists(_dir) && !_fs.mkdir(_dir))
+        return false;
+
+    File root = _fs.open(_dir);
+    if (!root || !root.isDirectory())
+        return false;
+
+    bool found = false;
+    uint32_t lowest = 0;
+    uint32_t highest = 0;
+    size_t highestSize = 0;
+    for (File f = root.openNextFile(); f; f = root.openNextFile())
+    {
+        // Older cores return the full path, newer ones just the name
+        const char *name = strrchr(f.name(), '/');
+        name = name ? name + 1 : f.name();
+
+        char *tail;
+        uint32_t segment = strtoul(name, &tail, 16);
+        if ((tail == name) || (*tail != '\0'))
+            continue;
+
+        if (!found || (segment < lowest))
+            lowest = segment;
+        if (!found || (segment >= highest))
+        {
+            highest = segment;
+            highestSize = f.size();
+        }
+        found = true;
+    }
+
+    _firstSegment = lowest;
+    _lastSegment = highest;
+    _lastBlocks = highestSize / HISTORY_BLOCK_BYTES;
+    if ((highestSize % HISTORY_BLOCK_BYTES != 0) || (_lastBlocks > _blocksPerSegment))
+    {
+        // Torn write at power off - leave the partial block behind and
+        // carry on in a fresh segment so the blocks stay aligned
+        _lastSegment++;
+        _lastBlocks = 0;
+    }
+
+    _ready = true;
+    return true;
+}
+
+bool HistorySegments::append(const uint8_t *block)
+{
+    if (!_ready)
+        return false;
+
+    if (_lastBlocks >= _blocksPerSegment)
+    {
+        _lastSegment++;
+        _lastBlocks = 0;
+    }
+
+    char path[32];
+    segmentPath(_lastSegment, path, sizeof(path));
+    File f = _fs.open(path, FILE_APPEND);
+    if (!f)
+        return false;
+    size_t written = f.write(block, HISTORY_BLOCK_BYTES);
+    f.close();
+
+    if (written != HISTORY_BLOCK_BYTES)
+    {
+        if (written > 0)
+        {
+            _lastSegment++;
+            _lastBlocks = 0;
+        }
+        return false;
+    }
+    _lastBlocks++;
+
+    while (_lastSegment - _firstSegment >= _maxSegments)
+    {
+        segmentPath(_firstSegment, path, sizeof(path));
+        _fs.remove(path);
+        _firstSegment++;
+    }
+    return true;
+}
+
+bool HistorySegments::read(Cursor &at, const Cursor &end, uint8_t *block)
+{
+    char path[32];
+    while (_ready && before(at, end))
+    {
+        if (at.segment < _firstSegment)
+            at = first();
+        else if (at.block >= _blocksPerSegment)
+            at = Cursor{at.segment + 1, 0};
+        else
+        {
+            segmentPath(at.segment, path, sizeof(path));
+            File f = _fs.open(path, FILE_READ);
+            if (f && f.seek((uint32_t)at.block * HISTORY_BLOCK_BYTES) &&
+                (f.read(block, HISTORY_BLOCK_BYTES) == HISTORY_BLOCK_BYTES))
+            {
+                at.block++;
+                return true;
+            }
+            // Missing, or shorter than expected after a torn write
+            at = Cursor{at.segment + 1, 0};
+        }
+    }
+    return false;
+}
+
+uint32_t HistorySegments::bytesUsed() const
+{
+    return ((_lastSegment - _firstSegment) * _blocksPerSegment + _lastBlocks) * HISTORY_BLOCK_BYTES;
+}
+
+void HistorySegments::segmentPath(uint32_t segment, char *path, size_t size) const
+{
+    snprintf(path, size, "%s/%08lx", _dir, (unsigned long)segment);
+}
+
+bool HistorySegments::before(const Cursor &a, const Cursor &b) const
+{
+    return (a.segment < b.segment) || ((a.segment == b.segment) && (a.block < b.block));
+}
+
+#endif
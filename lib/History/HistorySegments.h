@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <FS.h>
+
+#include "HistoryBlock.h"
+
+/**
+ * Append-only log of history blocks on a flash file system.
+ *
+ * Blocks are fixed size and go into numbered segment files of
+ * blocksPerSegment blocks each. Once there are more than maxSegments
+ * files the oldest is deleted, so the log never grows past
+ * maxSegments * blocksPerSegment * HISTORY_BLOCK_BYTES.
+ *
+ * Not thread safe - use it from one task.
+ */
+class HistorySegments
+{
+public:
+    /**
+     * A block position: segment number and block within it.
+     */
+    struct Cursor
+    {
+        uint32_t segment;
+        uint16_t block;
+    };
+
+    HistorySegments(fs::FS &fs, const char *dir, uint16_t blocksPerSegment, uint16_t maxSegments);
+
+    /**
+     * Finds the existing segments. The file system must be mounted.
+     * \return false if the directory can't be used; append() then fails
+     */
+    bool begin();
+
+    /**
+     * Writes one HISTORY_BLOCK_BYTES block after the last one.
+     * \return false if the write failed
+     */
+    bool append(const uint8_t *block);
+
+    /**
+     * \return position of the oldest stored block
+     */
+    Cursor first() const { return Cursor{_firstSegment, 0}; }
+
+    /**
+     * \return position just after the newest stored block
+     */
+    Cursor end() const { return Cursor{_lastSegment, _lastBlocks}; }
+
+    /**
+     * Reads the block at, and moves at to the next one. Blocks in segments
+     * deleted since the cursor was taken are skipped.
+     * \param at - position, advanced past the block read
+     * \param end - stop here, normally end() when the read started
+     * \param block - HISTORY_BLOCK_BYTES buffer
+     * \return false once at reaches end
+     */
+    bool read(Cursor &at, const Cursor &end, uint8_t *block);
+
+    /**
+     * \return bytes of flash used by stored blocks
+     */
+    uint32_t bytesUsed() const;
+
+    bool ready() const { return _ready; }
+
+private:
+    void segmentPath(uint32_t segment, char *path, size_t size) const;
+    bool before(const Cursor &a, const Cursor &b) const;
+
+    fs::FS &_fs;
+    const char *_dir;
+    uint16_t _blocksPerSegment;
+    uint16_t _maxSegments;
+    bool _ready;
+
+    uint32_t _firstSegment;
+    uint32_t _lastSegment;
+    uint16_t _lastBlocks; /// Blocks in the last segment
+};
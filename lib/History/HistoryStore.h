@@ -0,0 +1,204 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "HistoryBlock.h"
+#include "HistorySegments.h"
+
+/**
+ * Fixed size history of zone samples.
+ *
+ * Samples are compressed into the open block. Full blocks move to a RAM
+ * ring of the most recent RamBlocks blocks and from there to the flash
+ * segment log, if there is one. If flash writes fail the ring keeps the
+ * blocks and flush() retries; a block that falls off the ring before it
+ * reached flash is counted in lost().
+ *
+ * Queries walk flash, then the RAM blocks not yet on flash, then the open
+ * block, handing back one block at a time so the caller can send it in
+ * pieces across several passes.
+ *
+ * Not thread safe - record, flush and query from one task.
+ */
+template <size_t Zones, size_t RamBlocks>
+class HistoryStore
+{
+    static_assert(RamBlocks > 0, "Need at least one RAM block");
+
+public:
+    /**
+     * \param segments - flash log, or NULL to keep history in RAM only
+     */
+    explicit HistoryStore(HistorySegments *segments)
+        : _segments(segments), _sealed(0), _persisted(0), _samples(0), _bytes(0), _lost(0)
+    {
+        _query.active = false;
+    }
+
+    /**
+     * Adds a sample, sealing the open block when it is full.
+     */
+    void record(const HistorySample<Zones> &s)
+    {
+        size_t before = blockBytes();
+        if (!_writer.append(s))
+        {
+            seal();
+            _writer.reset();
+            _writer.append(s);
+            before = 0;
+        }
+
+        _bytes += blockBytes() - before;
+        _samples++;
+    }
+
+    /**
+     * Writes sealed blocks that aren't on flash yet.
+     */
+    void flush()
+    {
+        if ((_segments == NULL) || !_segments->ready())
+            return;
+
+        while (_persisted < _sealed)
+        {
+            if (!_segments->append(ramBlock(_persisted)))
+                break;
+            _persisted++;
+        }
+    }
+
+    /**
+     * Starts a query, dropping any query still running.
+     * \param from - epoch seconds, inclusive
+     * \param to - epoch seconds, inclusive
+     */
+    void beginQuery(uint32_t from, uint32_t to)
+    {
+        _query.active = true;
+        _query.phase = QUERY_FLASH;
+        _query.from = from;
+        _query.to = to;
+        _query.serial = _persisted;
+        if ((_segments != NULL) && _segments->ready())
+        {
+            _query.at = _segments->first();
+            _query.end = _segments->end();
+        }
+        else
+            _query.phase = QUERY_RAM;
+    }
+
+    bool queryActive() const { return _query.active; }
+
+    /**
+     * Copies out the next block holding samples in the query range.
+     * \param block - HISTORY_BLOCK_BYTES buffer
+     * \return false when the query is finished
+     */
+    bool nextBlock(uint8_t *block)
+    {
+        while (_query.active)
+        {
+            if (_query.phase == QUERY_FLASH)
+            {
+                if (_segments->read(_query.at, _query.end, block))
+                {
+                    if (historyBlockOverlaps(block, _query.from, _query.to))
+                        return true;
+                }
+                else
+                    _query.phase = QUERY_RAM;
+            }
+            else if (_query.phase == QUERY_RAM)
+            {
+                // Everything sealed since the query started is in RAM,
+                // whether or not it has reached flash since
+                if (_query.serial < _sealed)
+                {
+                    uint32_t serial = _query.serial++;
+                    if (_sealed - serial > RamBlocks)
+                        continue;
+                    memcpy(block, ramBlock(serial), HISTORY_BLOCK_BYTES);
+                    if (historyBlockOverlaps(block, _query.from, _query.to))
+                        return true;
+                }
+                else
+                    _query.phase = QUERY_OPEN;
+            }
+            else
+            {
+                _query.active = false;
+                memcpy(block, _writer.data(), HISTORY_BLOCK_BYTES);
+                if (historyBlockOverlaps(block, _query.from, _query.to))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * \return samples recorded since boot
+     */
+    uint32_t samples() const { return _samples; }
+
+    /**
+     * \return compressed bytes per sample since boot, block headers included
+     */
+    float bytesPerSample() const { return _samples ? (float)_bytes / _samples : 0; }
+
+    /**
+     * \return blocks that fell off the RAM ring before they reached flash
+     */
+    uint32_t lost() const { return _lost; }
+
+private:
+    enum QueryPhase : uint8_t
+    {
+        QUERY_FLASH,
+        QUERY_RAM,
+        QUERY_OPEN
+    };
+
+    struct Query
+    {
+        bool active;
+        QueryPhase phase;
+        uint32_t from;
+        uint32_t to;
+        HistorySegments::Cursor at;
+        HistorySegments::Cursor end;
+        uint32_t serial; /// Next RAM block
+    };
+
+    uint8_t *ramBlock(uint32_t serial) { return _ram[serial % RamBlocks]; }
+
+    size_t blockBytes() const { return _writer.empty() ? 0 : sizeof(HistoryBlockHeader) + _writer.header().used; }
+
+    void seal()
+    {
+        // The slot about to be reused may still be waiting for flash
+        if (_sealed - _persisted >= RamBlocks)
+        {
+            if ((_segments != NULL) && _segments->ready())
+                _lost++;
+            _persisted++;
+        }
+        memcpy(ramBlock(_sealed), _writer.data(), HISTORY_BLOCK_BYTES);
+        _sealed++;
+        flush();
+    }
+
+    HistorySegments *_segments;
+    HistoryBlockWriter<Zones> _writer;
+    uint8_t _ram[RamBlocks][HISTORY_BLOCK_BYTES];
+    uint32_t _sealed;    /// Blocks sealed since boot, also the next block's serial
+    uint32_t _persisted; /// Serial of the next block to write to flash
+    uint32_t _samples;
+    uint32_t _bytes;
+    uint32_t _lost;
+    Query _query;
+};
@@ -0,0 +1,60 @@
+#include "AsyncLogOutput.h"
+
+#include <stdio.h>
+
+bool AsyncLogOutput::begin(Print *target, UBaseType_t priority, BaseType_t core)
+{
+    _target = target;
+    return xTaskCreatePinnedToCore(drainTask, "logdrain", 3072, this, priority, &_task, core) == pdPASS;
+}
+
+size_t AsyncLogOutput::write(uint8_t c)
+{
+    return _ring.push((const char *)&c, 1) ? 1 : 0;
+}
+
+size_t AsyncLogOutput::write(const uint8_t *buffer, size_t size)
+{
+    return _ring.push((const char *)buffer, size) ? size : 0;
+}
+
+void AsyncLogOutput::drainTask(void *parameter)
+{
+    static_cast<AsyncLogOutput *>(parameter)->drain();
+}
+
+void AsyncLogOutput::drain()
+{
+    static_assert(LOG_DRAIN_CHUNK >= LOG_LINE_MAX, "Drain chunk must hold a whole line");
+
+    for (;;)
+    {
+        size_t used = 0;
+        while (sizeof(_chunk) - used >= LOG_LINE_MAX)
+        {
+            size_t len = _ring.pop(_chunk + used);
+            if (len == 0)
+                break;
+            if (_forward)
+                _forward->append(_chunk + used, len);
+            used += len;
+        }
+        if (used > 0)
+            _target->write((const uint8_t *)_chunk, used);
+        if (_forward)
+            _forward->poll();
+
+        uint32_t dropped = _ring.dropped();
+        if (dropped != _reported)
+        {
+            char note[48];
+            int len = snprintf(note, sizeof(note), "*** %u log lines dropped\n", (unsigned)(dropped - _reported));
+            _target->write((const uint8_t *)note, len);
+            _reported = dropped;
+        }
+
+        // Keep going while there is a backlog, otherwise wait for more
+        if (used == 0)
+            vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Print.h>
+#include "LogBatch.h"
+#include "LogLine.h"
+#include "LogRing.h"
+
+extern "C"
+{
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+}
+
+#ifndef LOG_RING_SLOTS
+#define LOG_RING_SLOTS 32 /// Lines buffered before new ones are dropped
+#endif
+#ifndef LOG_DRAIN_MS
+#define LOG_DRAIN_MS 20 /// Drain task poll period while the ring is empty
+#endif
+#ifndef LOG_DRAIN_CHUNK
+#define LOG_DRAIN_CHUNK 1024 /// Bytes gathered into each write to the target
+#endif
+
+/**
+ * Log output that queues each line and writes it to the real output from a
+ * background task, so logging never waits on a slow Serial port.
+ *
+ * Logging hands over each formatted line in one write(), which becomes one
+ * slot in a lock-free ring. A low-priority drain task batches queued lines
+ * into large writes to the target. When the ring is full, new lines are
+ * dropped and counted, and the drain task reports the count in the log.
+ *
+ *   AsyncLogOutput asyncLog;
+ *   asyncLog.begin(&Serial, 1, 0);
+ *   Log.begin(LOG_LEVEL_INFO, &asyncLog);
+ */
+class AsyncLogOutput : public Print
+{
+public:
+    AsyncLogOutput() : _target(NULL), _forward(NULL), _task(NULL), _reported(0) {}
+
+    /**
+     * Starts the drain task.
+     *
+     * \param target - where lines end up, e.g. &Serial
+     * \param priority - drain task priority, keep it below real work
+     * \param core - core to pin the drain task to
+     * \return false if the task could not be created
+     */
+    bool begin(Print *target, UBaseType_t priority, BaseType_t core);
+
+    /**
+     * Also hands every line to a batch (e.g. MQTT) from the drain task.
+     * Call before begin().
+     */
+    void forward(LogBatch *batch) { _forward = batch; }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+
+    /**
+     * \return lines dropped because the ring was full, since boot
+     */
+    uint32_t dropped() const { return _ring.dropped(); }
+
+    /**
+     * \return the drain task, NULL before begin()
+     */
+    TaskHandle_t task() const { return _task; }
+
+private:
+    static void drainTask(void *parameter);
+    void drain();
+
+    LogRing<LOG_RING_SLOTS, LOG_LINE_MAX> _ring;
+    Print *_target;
+    LogBatch *_forward;
+    TaskHandle_t _task;
+    uint32_t _reported;
+    char _chunk[LOG_DRAIN_CHUNK];
+};
@@ -0,0 +1,66 @@
+#include "LogBatch.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+LogBatch::LogBatch(PublishFunction publish, size_t flushBytes, uint32_t flushMs, uint32_t bytesPerSec)
+    : _publish(publish),
+      _flushBytes(flushBytes < LOG_BATCH_MAX ? flushBytes : LOG_BATCH_MAX),
+      _flushMs(flushMs),
+      _bytesPerSec(bytesPerSec),
+      _len(0),
+      _firstLineMs(0),
+      _tokens(LOG_BATCH_MAX),
+      _refillMs(0),
+      _dropped(0),
+      _published(0)
+{
+}
+
+void LogBatch::append(const char *line, size_t len)
+{
+    uint32_t now = millis();
+    if (_len + len > sizeof(_buf))
+        send(now);
+    if (_len + len > sizeof(_buf))
+    {
+        _dropped++;
+        return;
+    }
+
+    if (_len == 0)
+        _firstLineMs = now;
+    memcpy(_buf + _len, line, len);
+    _len += len;
+}
+
+void LogBatch::poll()
+{
+    uint32_t now = millis();
+    if ((_len >= _flushBytes) || ((_len > 0) && (now - _firstLineMs >= _flushMs)))
+        send(now);
+}
+
+bool LogBatch::send(uint32_t now)
+{
+    if (_len == 0)
+        return true;
+
+    // Token bucket, never holding more than one full batch
+    uint32_t refill = (uint64_t)(now - _refillMs) * _bytesPerSec / 1000;
+    if (refill > 0)
+    {
+        _tokens = (_tokens + refill > LOG_BATCH_MAX) ? LOG_BATCH_MAX : _tokens + refill;
+        _refillMs = now;
+    }
+    if (_tokens < _len)
+        return false;
+
+    if (!_publish(_buf, _len))
+        return false;
+
+    _tokens -= _len;
+    _len = 0;
+    _published++;
+    return true;
+}
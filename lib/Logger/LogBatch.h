@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef LOG_BATCH_MAX
+#define LOG_BATCH_MAX 1024 /// Largest batch handed to the publish function
+#endif
+
+/**
+ * Sends whole log lines somewhere slow (MQTT) in batches.
+ *
+ * Lines are appended to a buffer that is handed to the publish function
+ * once it holds flushBytes, or once its oldest line is flushMs old. A
+ * token bucket caps the average rate at bytesPerSec. If the buffer is full
+ * and can't be sent yet (rate cap, broker down), new lines are dropped
+ * and counted; nothing ever waits.
+ *
+ * Not thread safe - feed it from one task, normally the AsyncLogOutput
+ * drain task via AsyncLogOutput::forward().
+ */
+class LogBatch
+{
+public:
+    /**
+     * Sends a batch.
+     * \return false if it could not be sent; it is kept and retried
+     */
+    typedef bool (*PublishFunction)(const char *data, size_t len);
+
+    LogBatch(PublishFunction publish, size_t flushBytes, uint32_t flushMs, uint32_t bytesPerSec);
+
+    /**
+     * Adds one line, or drops it if there's no room.
+     */
+    void append(const char *line, size_t len);
+
+    /**
+     * Sends the batch if it is due and the rate cap allows.
+     */
+    void poll();
+
+    /**
+     * \return lines dropped since boot
+     */
+    uint32_t dropped() const { return _dropped; }
+
+    /**
+     * \return batches sent since boot
+     */
+    uint32_t published() const { return _published; }
+
+private:
+    bool send(uint32_t now);
+
+    PublishFunction _publish;
+    size_t _flushBytes;
+    uint32_t _flushMs;
+    uint32_t _bytesPerSec;
+
+    char _buf[LOG_BATCH_MAX];
+    size_t _len;
+    uint32_t _firstLineMs; /// When the oldest buffered line arrived
+    uint32_t _tokens;      /// Bytes that may be sent right now
+    uint32_t _refillMs;    /// Last token refill
+    volatile uint32_t _dropped;
+    volatile uint32_t _published;
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef LOG_BINARY_STRING_MAX
+#define LOG_BINARY_STRING_MAX 48 /// Longest RAM string copied into a binary record
+#endif
+
+// Strings in flash stay in the ELF, so a binary record only needs their
+// address. Anything else (RAM buffers) has to be copied into the record.
+#ifndef LOG_BINARY_IS_CONST
+#if defined(ESP32)
+#define LOG_BINARY_IS_CONST(p) ((uintptr_t)(p) >= 0x3F400000 && (uintptr_t)(p) < 0x3F800000) /// DROM
+#else
+#define LOG_BINARY_IS_CONST(p) false
+#endif
+#endif
+
+#define LOG_BINARY_VERSION 1
+
+/**
+ * Builds one binary log record and frames it for the wire.
+ *
+ * Record layout, before framing:
+ *
+ *   u8      version << 4 | level
+ *   varint  millis()
+ *   u32     address of the format string
+ *   u32     address of the LogScope name, 0 if none
+ *   ...     one field per format specifier:
+ *             d i x X b B c C t T   zigzag varint
+ *             l                     zigzag varint
+ *             u                     varint
+ *             D F                   float, little endian
+ *             s S p                 0x00 + u32 address, or
+ *                                   0x01 + u8 length + bytes
+ *
+ * The record is COBS encoded between two zero bytes, so a reader can pick
+ * up the stream at any point and text written to the same port (boot
+ * messages) stays separate. scripts/log_decode.py turns it
+ * back into text using the firmware ELF.
+ */
+class LogBinaryRecord
+{
+public:
+    static const size_t Max = 160; /// Largest record before framing
+
+    LogBinaryRecord() : _len(0), _overflow(false) {}
+
+    void putU8(uint8_t v)
+    {
+        if (_len < Max)
+            _buf[_len++] = v;
+        else
+            _overflow = true;
+    }
+
+    void putU32(uint32_t v)
+    {
+        for (int i = 0; i < 4; i++)
+            putU8(v >> (8 * i));
+    }
+
+    void putVarint(uint32_t v)
+    {
+        while (v >= 0x80)
+        {
+            putU8((v & 0x7F) | 0x80);
+            v >>= 7;
+        }
+        putU8(v);
+    }
+
+    void putSigned(int32_t v)
+    {
+        putVarint(((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+    }
+
+    void putFloat(float v)
+    {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        putU32(bits);
+    }
+
+    void putString(const char *s)
+    {
+        if (s == NULL)
+            s = "";
+        if (LOG_BINARY_IS_CONST(s))
+        {
+            putU8(0);
+            putU32((uint32_t)(uintptr_t)s);
+            return;
+        }
+        size_t n = strnlen(s, LOG_BINARY_STRING_MAX);
+        putU8(1);
+        putU8(n);
+        for (size_t i = 0; i < n; i++)
+            putU8(s[i]);
+    }
+
+    /**
+     * \return true if fields were lost because the record was full
+     */
+    bool overflowed() const { return _overflow; }
+
+    /**
+     * COBS encodes the record into out between zero delimiters.
+     * \param out - at least frameMax() bytes
+     * \return the frame length
+     */
+    size_t frame(uint8_t *out) const
+    {
+        out[0] = 0;
+        size_t o = 2;
+        size_t code = 1;
+        uint8_t run = 1;
+        for (size_t i = 0; i < _len; i++)
+        {
+            if (_buf[i] == 0)
+            {
+                out[code] = run;
+                code = o++;
+                run = 1;
+                continue;
+            }
+            out[o++] = _buf[i];
+            if (++run == 0xFF)
+            {
+                out[code] = run;
+                code = o++;
+                run = 1;
+            }
+        }
+        out[code] = run;
+        out[o++] = 0;
+        return o;
+    }
+
+    static constexpr size_t frameMax() { return Max + Max / 254 + 3; }
+
+private:
+    uint8_t _buf[Max];
+    size_t _len;
+    bool _overflow;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Print.h>
+#include <string.h>
+
+#ifndef LOG_LINE_MAX
+#define LOG_LINE_MAX 192 /// Longest formatted log line, longer lines are truncated
+#endif
+
+/**
+ * Fixed buffer a log line is formatted into before it is handed to the
+ * output in a single write. Lives on the caller's stack; never allocates.
+ * The last byte is kept back so a truncated line still ends in a newline.
+ */
+class LogLine : public Print
+{
+public:
+    LogLine() : _len(0) {}
+
+    using Print::write;
+
+    size_t write(uint8_t c) override
+    {
+        if (_len >= LOG_LINE_MAX - 1)
+            return 0;
+        _buf[_len++] = c;
+        return 1;
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        size_t room = LOG_LINE_MAX - 1 - _len;
+        if (size > room)
+            size = room;
+        memcpy(_buf + _len, buffer, size);
+        _len += size;
+        return size;
+    }
+
+    /**
+     * Ends the line, using the reserved byte if the buffer is full.
+     */
+    void newline()
+    {
+        _buf[_len++] = '\n';
+    }
+
+    /**
+     * \return the text so far, NUL terminated in the reserved byte
+     */
+    const char *c_str()
+    {
+        _buf[_len < LOG_LINE_MAX ? _len : LOG_LINE_MAX - 1] = 0;
+        return _buf;
+    }
+
+    const uint8_t *data() const { return (const uint8_t *)_buf; }
+    size_t length() const { return _len; }
+
+private:
+    char _buf[LOG_LINE_MAX];
+    size_t _len;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Bounded lock-free queue of log lines: any number of producers, one
+ * consumer.
+ *
+ * Each slot holds one whole line, claimed with a single compare-and-swap
+ * on the write position (Vyukov's bounded queue). A producer never waits:
+ * if the ring is full the line is dropped and counted instead.
+ *
+ * \tparam Slots   - number of lines buffered, a power of two
+ * \tparam LineMax - longest line stored, longer lines are truncated
+ */
+template <size_t Slots, size_t LineMax>
+class LogRing
+{
+    static_assert(Slots >= 2 && (Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+
+public:
+    LogRing() : _head(0), _tail(0), _dropped(0)
+    {
+        for (size_t i = 0; i < Slots; i++)
+            _slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    /**
+     * Queues one line. Safe from any number of tasks at once.
+     * \return false if the ring was full and the line was dropped
+     */
+    bool push(const char *data, size_t len)
+    {
+        if (len == 0)
+            return true;
+        if (len > LineMax)
+            len = LineMax;
+
+        uint32_t pos = _head.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;)
+        {
+            slot = &_slots[pos & (Slots - 1)];
+            int32_t diff = (int32_t)(slot->seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0)
+            {
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+
+        memcpy(slot->text, data, len);
+        slot->len = len;
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Takes the oldest line. Consumer task only.
+     * \param out - receives the line, must hold at least LineMax bytes
+     * \return the line length, or 0 if the ring is empty
+     */
+    size_t pop(char *out)
+    {
+        uint32_t pos = _tail.load(std::memory_order_relaxed);
+        Slot &slot = _slots[pos & (Slots - 1)];
+        if ((int32_t)(slot.seq.load(std::memory_order_acquire) - (pos + 1)) != 0)
+            return 0;
+
+        size_t len = slot.len;
+        memcpy(out, slot.text, len);
+        slot.seq.store(pos + Slots, std::memory_order_release);
+        _tail.store(pos + 1, std::memory_order_relaxed);
+        return len;
+    }
+
+    /**
+     * \return lines dropped because the ring was full, since boot
+     */
+    uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    static constexpr size_t capacity() { return Slots; }
+    static constexpr size_t lineMax() { return LineMax; }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> seq;
+        uint16_t len;
+        char text[LineMax];
+    };
+
+    Slot _slots[Slots];
+    std::atomic<uint32_t> _head;
+    std::atomic<uint32_t> _tail;
+    std::atomic<uint32_t> _dropped;
+};
@@ -0,0 +1,43 @@
+#include "LogScope.h"
+#include "ScopeTrace.h"
+
+namespace
+{
+    struct ScopeStack
+    {
+        const char *names[LOG_SCOPE_DEPTH];
+        uint8_t depth;
+    };
+
+    // One stack per FreeRTOS task
+    thread_local ScopeStack scopes = {{0}, 0};
+}
+
+LogScope::LogScope(const char *name) : _name(name)
+{
+    scopeTraceRecord(name, 'B');
+    if (scopes.depth < LOG_SCOPE_DEPTH)
+        scopes.names[scopes.depth] = name;
+    if (scopes.depth < UINT8_MAX)
+        scopes.depth++;
+}
+
+LogScope::~LogScope()
+{
+    scopeTraceRecord(_name, 'E');
+    if (scopes.depth > 0)
+        scopes.depth--;
+}
+
+const char *LogScope::current()
+{
+    if (scopes.depth == 0)
+        return NULL;
+    uint8_t top = (scopes.depth < LOG_SCOPE_DEPTH) ? scopes.depth : LOG_SCOPE_DEPTH;
+    return scopes.names[top - 1];
+}
+
+uint8_t LogScope::depth()
+{
+    return scopes.depth;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#ifndef LOG_SCOPE_DEPTH
+#define LOG_SCOPE_DEPTH 16 /// Nested scopes remembered per task
+#endif
+
+/**
+ * Names the current function for the log prefix without touching the heap.
+ *
+ * Construct one at the top of a function; the name is pushed on a small
+ * per-task stack of const char* and popped again when the scope ends.
+ * Scopes nested deeper than LOG_SCOPE_DEPTH are counted but not stored, so
+ * current() then keeps reporting the deepest stored name.
+ *
+ * Every scope also records a begin and an end event in the scope trace
+ * (ScopeTrace.h), unless SCOPE_TRACE_EVENTS is 0.
+ *
+ *   void storePrefs()
+ *   {
+ *     LogScope scope("storePrefs()");
+ *     ...
+ *   }
+ */
+class LogScope
+{
+public:
+    explicit LogScope(const char *name);
+    ~LogScope();
+
+    LogScope(const LogScope &) = delete;
+    LogScope &operator=(const LogScope &) = delete;
+
+    /**
+     * \return the innermost scope name on the calling task, or NULL if none
+     */
+    static const char *current();
+
+    /**
+     * \return how many scopes are open on the calling task
+     */
+    static uint8_t depth();
+
+private:
+    const char *_name;
+};
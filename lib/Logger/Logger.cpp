@@ -30,6 +30,8 @@ SOFTWARE.
 */
 
 #include "Logger.h"
+#include "LogBinary.h"
+#include "LogScope.h"
 #define __x86_64__
 void Logging::begin(int level, Print *logOutput, bool showLevel)
 {
@@ -43,7 +45,7 @@ void Logging::begin(int level, Print *logOutput, bool showLevel)
 void Logging::setLevel(int level)
 {
 #ifndef DISABLE_LOGGING
-    _level = constrain(level, LOG_LEVEL_SILENT, LOG_LEVEL_VERBOSE);
+    _level = constrain(level, LOG_LEVEL_SILENT, LOG_COMPILED_LEVEL);
 #endif
 }
 
@@ -72,6 +74,22 @@ bool Logging::getShowLevel() const
 #endif
 }
 
+void Logging::setBinary(bool binary)
+{
+#ifndef DISABLE_LOGGING
+    _binary = binary;
+#endif
+}
+
+bool Logging::getBinary() const
+{
+#ifndef DISABLE_LOGGING
+    return _binary;
+#else
+    return false;
+#endif
+}
+
 void Logging::setPrefix(printfunction f)
 {
 #ifndef DISABLE_LOGGING
@@ -100,7 +118,7 @@ void Logging::clearSuffix()
 #endif
 }
 
-void Logging::print(const __FlashStringHelper *format, va_list args)
+void Logging::print(Print *out, const __FlashStringHelper *format, va_list args)
 {
 #ifndef DISABLE_LOGGING
     PGM_P p = reinterpret_cast<PGM_P>(format);
@@ -117,14 +135,14 @@ void Logging::print(const __FlashStringHelper *format, va_list args)
         {
             c = pgm_read_byte(p++);
 #ifdef __x86_64__
-            printFormat(c, &args_copy);
+            printFormat(out, c, &args_copy);
 #else
-            printFormat(c, &args);
+            printFormat(out, c, &args);
 #endif
         }
         else
         {
-            _logOutput->print(c);
+            out->print(c);
         }
     }
 #ifdef __x86_64__
@@ -133,7 +151,7 @@ void Logging::print(const __FlashStringHelper *format, va_list args)
 #endif
 }
 
-void Logging::print(const char *format, va_list args)
+void Logging::print(Print *out, const char *format, va_list args)
 {
 #ifndef DISABLE_LOGGING
 // This copy is only necessary on some architectures (x86) to change a passed
@@ -148,14 +166,14 @@ void Logging::print(const char *format, va_list args)
         {
             ++format;
 #ifdef __x86_64__
-            printFormat(*format, &args_copy);
+            printFormat(out, *format, &args_copy);
 #else
-            printFormat(*format, &args);
+            printFormat(out, *format, &args);
 #endif
         }
         else
         {
-            _logOutput->print(*format);
+            out->print(*format);
         }
     }
 #ifdef __x86_64__
@@ -164,114 +182,191 @@ void Logging::print(const char *format, va_list args)
 #endif
 }
 
-void Logging::printFormat(const char format, va_list *args)
+void Logging::printFormat(Print *out, const char format, va_list *args)
 {
 #ifndef DISABLE_LOGGING
     if (format == '\0')
         return;
     if (format == '%')
     {
-        _logOutput->print(format);
+        out->print(format);
     }
     else if (format == 's')
     {
         register char *s = va_arg(*args, char *);
-        _logOutput->print(s);
+        out->print(s);
     }
     else if (format == 'S')
     {
         register __FlashStringHelper *s = va_arg(*args, __FlashStringHelper *);
-        _logOutput->print(s);
+        out->print(s);
     }
     else if (format == 'd' || format == 'i')
     {
-        _logOutput->print(va_arg(*args, int), DEC);
+        out->print(va_arg(*args, int), DEC);
     }
     else if (format == 'D' || format == 'F')
     {
-        _logOutput->print(va_arg(*args, double));
+        out->print(va_arg(*args, double));
     }
     else if (format == 'x')
     {
-        _logOutput->print(va_arg(*args, int), HEX);
+        out->print(va_arg(*args, int), HEX);
     }
     else if (format == 'X')
     {
-        _logOutput->print("0x");
-        //_logOutput->print(va_arg(*args, int), HEX);
+        out->print("0x");
+        //out->print(va_arg(*args, int), HEX);
         register uint16_t h = (uint16_t)va_arg(*args, int);
         if (h < 0xFFF)
-            _logOutput->print('0');
+            out->print('0');
         if (h < 0xFF)
-            _logOutput->print('0');
+            out->print('0');
         if (h < 0xF)
-            _logOutput->print('0');
-        _logOutput->print(h, HEX);
+            out->print('0');
+        out->print(h, HEX);
     }
     else if (format == 'p')
     {
         register Printable *obj = (Printable *)va_arg(*args, int);
-        _logOutput->print(*obj);
+        out->print(*obj);
     }
     else if (format == 'b')
     {
-        _logOutput->print(va_arg(*args, int), BIN);
+        out->print(va_arg(*args, int), BIN);
     }
     else if (format == 'B')
     {
-        _logOutput->print("0b");
-        _logOutput->print(va_arg(*args, int), BIN);
+        out->print("0b");
+        out->print(va_arg(*args, int), BIN);
     }
     else if (format == 'l')
     {
-        _logOutput->print(va_arg(*args, long), DEC);
+        out->print(va_arg(*args, long), DEC);
     }
     else if (format == 'u')
     {
-        _logOutput->print(va_arg(*args, unsigned long), DEC);
+        out->print(va_arg(*args, unsigned long), DEC);
     }
     else if (format == 'c')
     {
-        _logOutput->print((char)va_arg(*args, int));
+        out->print((char)va_arg(*args, int));
     }
     else if (format == 'C')
     {
         register char c = (char)va_arg(*args, int);
         if (c >= 0x20 && c < 0x7F)
         {
-            _logOutput->print(c);
+            out->print(c);
         }
         else
         {
-            _logOutput->print("0x");
+            out->print("0x");
             if (c < 0xF)
-                _logOutput->print('0');
-            _logOutput->print(c, HEX);
+                out->print('0');
+            out->print(c, HEX);
         }
     }
     else if (format == 't')
     {
         if (va_arg(*args, int) == 1)
         {
-            _logOutput->print("T");
+            out->print("T");
         }
         else
         {
-            _logOutput->print("F");
+            out->print("F");
         }
     }
     else if (format == 'T')
     {
         if (va_arg(*args, int) == 1)
         {
-            _logOutput->print(F("true"));
+            out->print(F("true"));
         }
         else
         {
-            _logOutput->print(F("false"));
+            out->print(F("false"));
         }
     }
 #endif
 }
 
+static void writeBinaryHeader(LogBinaryRecord &rec, int level, const char *format)
+{
+    rec.putU8((LOG_BINARY_VERSION << 4) | level);
+    rec.putVarint(millis());
+    rec.putU32((uint32_t)(uintptr_t)format);
+    rec.putU32((uint32_t)(uintptr_t)LogScope::current());
+}
+
+void Logging::printBinary(int level, const char *format, va_list args)
+{
+#ifndef DISABLE_LOGGING
+    LogBinaryRecord rec;
+    writeBinaryHeader(rec, level, format);
+
+    // Only the specifiers are read here - nothing is formatted
+    va_list ap;
+    va_copy(ap, args);
+    for (const char *p = format; *p != 0; ++p)
+    {
+        if (*p != '%')
+            continue;
+        switch (*++p)
+        {
+        case 'd': case 'i': case 'x': case 'X': case 'b': case 'B':
+        case 'c': case 'C': case 't': case 'T':
+            rec.putSigned(va_arg(ap, int));
+            break;
+        case 'l':
+            rec.putSigned(va_arg(ap, long));
+            break;
+        case 'u':
+            rec.putVarint(va_arg(ap, unsigned long));
+            break;
+        case 'D': case 'F':
+            rec.putFloat(va_arg(ap, double));
+            break;
+        case 's': case 'S':
+            rec.putString(va_arg(ap, const char *));
+            break;
+        case 'p':
+        {
+            LogLine text;
+            text.print(*(Printable *)va_arg(ap, void *));
+            rec.putString(text.c_str());
+            break;
+        }
+        case 0:
+            --p;
+            break;
+        default:
+            break;
+        }
+    }
+    va_end(ap);
+
+    uint8_t frame[LogBinaryRecord::frameMax()];
+    _logOutput->write(frame, rec.frame(frame));
+#endif
+}
+
+void Logging::printBinary(int level, const Printable& obj, va_list args)
+{
+#ifndef DISABLE_LOGGING
+    // No format string to point at, so send the text as a %s argument
+    static const char textFormat[] = "%s";
+    LogBinaryRecord rec;
+    writeBinaryHeader(rec, level, textFormat);
+
+    LogLine text;
+    text.print(obj);
+    rec.putString(text.c_str());
+
+    uint8_t frame[LogBinaryRecord::frameMax()];
+    _logOutput->write(frame, rec.frame(frame));
+#endif
+}
+
 Logging Log = Logging();
\ No newline at end of file
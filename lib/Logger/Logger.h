@@ -29,6 +29,8 @@ Licensed under the MIT License <http://opensource.org/licenses/MIT>.
 #define PSTR(str) (str)
 #define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
 #endif
+#include "LogLine.h"
+
 typedef void (*printfunction)(Print*, int);
 
 
@@ -46,6 +48,37 @@ typedef void (*printfunction)(Print*, int);
 #define LOG_LEVEL_TRACE   5
 #define LOG_LEVEL_VERBOSE 6
 
+// *************************************************************************
+//  Highest level compiled into the binary. Calls above it are removed at
+//  compile time, and the LOG_* macros below also skip evaluating their
+//  arguments. Build with e.g. -DLOG_COMPILED_LEVEL=LOG_LEVEL_INFO for
+//  release; setLevel() can't go past it at runtime.
+// ************************************************************************
+#ifndef LOG_COMPILED_LEVEL
+#ifdef DISABLE_LOGGING
+#define LOG_COMPILED_LEVEL LOG_LEVEL_SILENT
+#else
+#define LOG_COMPILED_LEVEL LOG_LEVEL_VERBOSE
+#endif
+#endif
+
+#define LOG_AT(level, method, ...) \
+	do { if ((level) <= LOG_COMPILED_LEVEL) Log.method(__VA_ARGS__); } while (0)
+#define LOG_FATAL(...)     LOG_AT(LOG_LEVEL_FATAL, fatal, __VA_ARGS__)
+#define LOG_FATALLN(...)   LOG_AT(LOG_LEVEL_FATAL, fatalln, __VA_ARGS__)
+#define LOG_ERROR(...)     LOG_AT(LOG_LEVEL_ERROR, error, __VA_ARGS__)
+#define LOG_ERRORLN(...)   LOG_AT(LOG_LEVEL_ERROR, errorln, __VA_ARGS__)
+#define LOG_WARNING(...)   LOG_AT(LOG_LEVEL_WARNING, warning, __VA_ARGS__)
+#define LOG_WARNINGLN(...) LOG_AT(LOG_LEVEL_WARNING, warningln, __VA_ARGS__)
+#define LOG_NOTICE(...)    LOG_AT(LOG_LEVEL_NOTICE, notice, __VA_ARGS__)
+#define LOG_NOTICELN(...)  LOG_AT(LOG_LEVEL_NOTICE, noticeln, __VA_ARGS__)
+#define LOG_INFO(...)      LOG_AT(LOG_LEVEL_INFO, info, __VA_ARGS__)
+#define LOG_INFOLN(...)    LOG_AT(LOG_LEVEL_INFO, infoln, __VA_ARGS__)
+#define LOG_TRACE(...)     LOG_AT(LOG_LEVEL_TRACE, trace, __VA_ARGS__)
+#define LOG_TRACELN(...)   LOG_AT(LOG_LEVEL_TRACE, traceln, __VA_ARGS__)
+#define LOG_VERBOSE(...)   LOG_AT(LOG_LEVEL_VERBOSE, verbose, __VA_ARGS__)
+#define LOG_VERBOSELN(...) LOG_AT(LOG_LEVEL_VERBOSE, verboseln, __VA_ARGS__)
+
 #define CR "\n"
 #define LF "\r"
 #define NL "\n\r"
@@ -128,7 +161,7 @@ public:
 	void begin(int level, Print *output, bool showLevel = true);
 
 	/**
-	 * Set the log level.
+	 * Set the log level. Levels above LOG_COMPILED_LEVEL are clamped to it.
 	 * 
 	 * \param level - The new log level.
 	 * \return void
@@ -159,6 +192,22 @@ public:
 	 */
 	bool getShowLevel() const;
 
+	/**
+	 * Switch between text and binary records. In binary mode nothing is
+	 * formatted on the device: each call writes a small framed record with
+	 * the format string address and raw arguments, and the prefix and
+	 * suffix functions are not called. Decode with scripts/log_decode.py.
+	 *
+	 * \param binary - true for binary records, false for text
+	 * \return void
+	 */
+	void setBinary(bool binary);
+
+	/**
+	 * \return true if records are written in binary
+	 */
+	bool getBinary() const;
+
 	/**
 	 * Sets a function to be called before each log command.
 	 * 
@@ -201,13 +250,15 @@ public:
 	 */
   template <class T, typename... Args> void fatal(T msg, Args... args){
 #ifndef DISABLE_LOGGING
-    printLevel(LOG_LEVEL_FATAL, false, msg, args...);
+    if constexpr (LOG_LEVEL_FATAL <= LOG_COMPILED_LEVEL)
+      printLevel(LOG_LEVEL_FATAL, false, msg, args...);
 #endif
   }
 
   template <class T, typename... Args> void fatalln(T msg, Args... args){
 #ifndef DISABLE_LOGGING
-    printLevel(LOG_LEVEL_FATAL, true, msg, args...);
+    if constexpr (LOG_LEVEL_FATAL <= LOG_COMPILED_LEVEL)
+      printLevel(LOG_LEVEL_FATAL, true, msg, args...);
 #endif
   }
 
@@ -223,13 +274,15 @@ public:
 	 */
   template <class T, typename... Args> void error(T msg, Args... args){
 #ifndef DISABLE_LOGGING
-    printLevel(LOG_LEVEL_ERROR, false, msg, args...);
+    if constexpr (LOG_LEVEL_ERROR <= LOG_COMPILED_LEVEL)
+      printLevel(LOG_LEVEL_ERROR, false, msg, args...);
 #endif
   }
   
    template <class T, typename... Args> void errorln(T msg, Args... args){
 #ifndef DISABLE_LOGGING
-    printLevel(LOG_LEVEL_ERROR, true, msg, args...);
+    if constexpr (LOG_LEVEL_ERROR <= LOG_COMPILED_LEVEL)
+      printLevel(LOG_LEVEL_ERROR, true, msg, args...);
 #endif
   } 
 	/**
@@ -244,13 +297,15 @@ public:
 	 */
   template <class T, typename... Args> void warning(T msg, Args...args){
 #ifndef DISABLE_LOGGING
-    printLevel(LOG_LEVEL_WARNING, false, msg, args...);
+    if constexpr (LOG_LEVEL_WARNING <= LOG_COMPILED_LEVEL)
+      printLevel(LOG_LEVEL_WARNING, false, msg, args...);
 #endif
   }
   
    template <class T, typename... Args> void warningln(T msg, Args...args){
 #ifndef DISABLE_LOGGING
-    printLevel(LOG_LEVEL_WARNING, true, msg, args...);
+    if constexpr (LOG_LEVEL_WARNING <= LOG_COMPILED_LEVEL)
+      printLevel(LOG_LEVEL_WARNING, true, msg, args...);
 #endif
   } 
 
@@ -266,25 +321,29 @@ public:
 	 */
   template <class T, typename... Args> void notice(T msg, Args...args){
 #ifndef DISABLE_LOGGING
-    printLevel(LOG_LEVEL_NOTICE, false, msg, args...);
+    if constexpr (LOG_LEVEL_NOTICE <= LOG_COMPILED_LEVEL)
+      printLevel(LOG_LEVEL_NOTICE, false, msg, args...);
 #endif
   }
   
   template <class T, typename... Args> void noticeln(T msg, Args...args){
 #ifndef DISABLE_LOGGING
-    printLevel(LOG_LEVEL_NOTICE, true, msg, args...);
+    if constexpr (LOG_LEVEL_NOTICE <= LOG_COMPILED_LEVEL)
+      printLevel(LOG_LEVEL_NOTICE, true, msg, args...);
 #endif
   }  
 
   template <class T, typename... Args> void info(T msg, Args...args) {
 #ifndef DISABLE_LOGGING
-	  printLevel(LOG_LEVEL_INFO, false, msg, args...);
+	  if constexpr (LOG_LEVEL_INFO <= LOG_COMPILED_LEVEL)
+	    printLevel(LOG_LEVEL_INFO, false, msg, args...);
 #endif
   }
 
   template <class T, typename... Args> void infoln(T msg, Args...args) {
 #ifndef DISABLE_LOGGING
-	  printLevel(LOG_LEVEL_INFO, true, msg, args...);
+	  if constexpr (LOG_LEVEL_INFO <= LOG_COMPILED_LEVEL)
+	    printLevel(LOG_LEVEL_INFO, true, msg, args...);
 #endif
   }
 
@@ -300,13 +359,15 @@ public:
 	*/
   template <class T, typename... Args> void trace(T msg, Args... args){
 #ifndef DISABLE_LOGGING
-    printLevel(LOG_LEVEL_TRACE, false, msg, args...);
+    if constexpr (LOG_LEVEL_TRACE <= LOG_COMPILED_LEVEL)
+      printLevel(LOG_LEVEL_TRACE, false, msg, args...);
 #endif
   }
 
   template <class T, typename... Args> void traceln(T msg, Args... args){
 #ifndef DISABLE_LOGGING
-    printLevel(LOG_LEVEL_TRACE, true, msg, args...);
+    if constexpr (LOG_LEVEL_TRACE <= LOG_COMPILED_LEVEL)
+      printLevel(LOG_LEVEL_TRACE, true, msg, args...);
 #endif
 	}
 
@@ -322,29 +383,40 @@ public:
 	 */
   template <class T, typename... Args> void verbose(T msg, Args... args){
 #ifndef DISABLE_LOGGING
-    printLevel(LOG_LEVEL_VERBOSE, false, msg, args...);
+    if constexpr (LOG_LEVEL_VERBOSE <= LOG_COMPILED_LEVEL)
+      printLevel(LOG_LEVEL_VERBOSE, false, msg, args...);
 #endif
   }
 
   template <class T, typename... Args> void verboseln(T msg, Args... args){
 #ifndef DISABLE_LOGGING
-    printLevel(LOG_LEVEL_VERBOSE, true, msg, args...);
+    if constexpr (LOG_LEVEL_VERBOSE <= LOG_COMPILED_LEVEL)
+      printLevel(LOG_LEVEL_VERBOSE, true, msg, args...);
 #endif
   }
 
 private:
-	void print(const char *format, va_list args);
+	void print(Print *out, const char *format, va_list args);
 
-	void print(const __FlashStringHelper *format, va_list args);
+	void print(Print *out, const __FlashStringHelper *format, va_list args);
 
-	void print(const Printable& obj, va_list args)
+	void print(Print *out, const Printable& obj, va_list args)
 	{
 #ifndef DISABLE_LOGGING
-		_logOutput->print(obj);
+		out->print(obj);
 #endif
 	}
 
-	void printFormat(const char format, va_list *args);
+	void printFormat(Print *out, const char format, va_list *args);
+
+	void printBinary(int level, const char *format, va_list args);
+
+	void printBinary(int level, const __FlashStringHelper *format, va_list args)
+	{
+		printBinary(level, reinterpret_cast<const char *>(format), args);
+	}
+
+	void printBinary(int level, const Printable& obj, va_list args);
 
 	template <class T> void printLevel(int level, bool cr, T msg, ...)
 	{
@@ -357,38 +429,53 @@ private:
 		{
 			level = LOG_LEVEL_SILENT;
 		}
-			
+
+		if (_binary)
+		{
+			va_list args;
+			va_start(args, msg);
+			printBinary(level, msg, args);
+			va_end(args);
+			return;
+		}
+
+		// Format the whole line first so the output gets it in one write
+		LogLine line;
 
 		if (_prefix != NULL)
 		{
-			_prefix(_logOutput, level);
+			_prefix(&line, level);
 		}
 
 		if (_showLevel) {
 			static const char levels[] = "FEWITV";
 			//static const char logLevels[][] = {"FATAL", "ERROR", "WARN", "INFO", "TRACE", "VERBOSE"};
-			_logOutput->print(levels[level - 1]);
-			_logOutput->print(": ");
+			line.print(levels[level - 1]);
+			line.print(": ");
 		}
 
 		va_list args;
 		va_start(args, msg);
-		print(msg, args);
+		print(&line, msg, args);
+		va_end(args);
 
 		if(_suffix != NULL)
 		{
-			_suffix(_logOutput, level);
+			_suffix(&line, level);
 		}
 		if (cr)
 		{
-		    _logOutput->print(CR);
+		    line.newline();
 		}
+
+		_logOutput->write(line.data(), line.length());
 #endif
 	}
 
 #ifndef DISABLE_LOGGING
 	int _level;
 	bool _showLevel;
+	bool _binary = false;
 	Print* _logOutput;
 
 	printfunction _prefix = NULL;
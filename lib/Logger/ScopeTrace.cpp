@@ -0,0 +1,125 @@
+#include "ScopeTrace.h"
+
+#include <stdio.h>
+
+#if defined(ARDUINO_ARCH_ESP32) && (SCOPE_TRACE_EVENTS > 0)
+
+#include <Arduino.h>
+extern "C"
+{
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+}
+#include "esp_ipc.h"
+#include "esp_timer.h"
+
+namespace
+{
+    ScopeTraceRing<SCOPE_TRACE_EVENTS> ring;
+
+    struct ClockReading
+    {
+        uint32_t cycles;
+        int64_t us;
+    };
+
+    void readClock(void *arg)
+    {
+        ClockReading *r = (ClockReading *)arg;
+        r->cycles = ESP.getCycleCount();
+        r->us = esp_timer_get_time();
+    }
+}
+
+void scopeTraceRecord(const char *name, char phase)
+{
+    ring.record({ESP.getCycleCount(), name, pcTaskGetName(NULL), (uint8_t)xPortGetCoreID(), phase});
+}
+
+bool scopeTraceRead(uint32_t serial, ScopeTraceEvent &e)
+{
+    return ring.read(serial, e);
+}
+
+uint32_t scopeTraceWritten()
+{
+    return ring.written();
+}
+
+uint32_t scopeTraceOldest()
+{
+    return ring.oldest();
+}
+
+void scopeTracePause(bool paused)
+{
+    ring.pause(paused);
+}
+
+bool scopeTraceClock(uint8_t core, uint32_t &cycles, int64_t &us)
+{
+    ClockReading r;
+    if (core == xPortGetCoreID())
+        readClock(&r);
+    else if (esp_ipc_call_blocking(core, readClock, &r) != ESP_OK)
+        return false;
+    cycles = r.cycles;
+    us = r.us;
+    return true;
+}
+
+uint32_t scopeTraceCpuMHz()
+{
+    return ESP.getCpuFreqMHz();
+}
+
+#else
+
+void scopeTraceRecord(const char *name, char phase)
+{
+}
+
+bool scopeTraceRead(uint32_t serial, ScopeTraceEvent &e)
+{
+    return false;
+}
+
+uint32_t scopeTraceWritten()
+{
+    return 0;
+}
+
+uint32_t scopeTraceOldest()
+{
+    return 0;
+}
+
+void scopeTracePause(bool paused)
+{
+}
+
+bool scopeTraceClock(uint8_t core, uint32_t &cycles, int64_t &us)
+{
+    return false;
+}
+
+uint32_t scopeTraceCpuMHz()
+{
+    return 0;
+}
+
+#endif
+
+size_t scopeTraceFormat(uint32_t serial, const ScopeTraceEvent &e, char *buf, size_t size)
+{
+    int len = snprintf(buf, size, "T %lu %u %c %lu %s %s\n", (unsigned long)serial, e.core, e.phase,
+                       (unsigned long)e.cycles, e.task ? e.task : "?", e.name ? e.name : "?");
+    if ((len < 0) || (size < 2))
+        return 0;
+    if ((size_t)len < size)
+        return len;
+
+    // Truncated, but still one whole line
+    buf[size - 2] = '\n';
+    return size - 1;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SCOPE_TRACE_EVENTS
+#define SCOPE_TRACE_EVENTS 512 /// Begin/end events kept (20 bytes each), 0 compiles tracing out
+#endif
+
+/**
+ * One scope begin or end, as recorded by LogScope.
+ */
+struct ScopeTraceEvent
+{
+    uint32_t cycles;  /// CPU cycle counter of the core it ran on
+    const char *name; /// Scope name, a literal
+    const char *task; /// Task name, owned by the task
+    uint8_t core;
+    char phase; /// 'B' or 'E'
+};
+
+/**
+ * Flight recorder of the last Events scope events.
+ *
+ * Any task on either core can record; each event claims the next slot with
+ * one atomic increment and overwrites whatever was there, so recording
+ * never waits and the ring always holds the newest events. Each slot
+ * carries the serial of the event in it, which lets a reader spot slots
+ * that were overwritten or half written while it copied them.
+ *
+ * \tparam Events - events kept, a power of two
+ */
+template <size_t Events>
+class ScopeTraceRing
+{
+    static_assert(Events >= 2 && (Events & (Events - 1)) == 0, "Events must be a power of two");
+
+public:
+    ScopeTraceRing() : _next(0), _paused(false)
+    {
+        for (size_t i = 0; i < Events; i++)
+            _slots[i].serial.store(0, std::memory_order_relaxed);
+    }
+
+    void record(const ScopeTraceEvent &e)
+    {
+        if (_paused.load(std::memory_order_relaxed))
+            return;
+
+        uint32_t pos = _next.fetch_add(1, std::memory_order_relaxed);
+        Slot &slot = _slots[pos & (Events - 1)];
+        slot.serial.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.event = e;
+        slot.serial.store(pos + 1, std::memory_order_release);
+    }
+
+    /**
+     * Copies out one event.
+     * \param serial - event number, from oldest() up to written() - 1
+     * \return false if the event has been overwritten or is being written
+     */
+    bool read(uint32_t serial, ScopeTraceEvent &e) const
+    {
+        const Slot &slot = _slots[serial & (Events - 1)];
+        if (slot.serial.load(std::memory_order_acquire) != serial + 1)
+            return false;
+        e = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.serial.load(std::memory_order_relaxed) == serial + 1;
+    }
+
+    /**
+     * \return events recorded since boot, also the next event's serial
+     */
+    uint32_t written() const { return _next.load(std::memory_order_acquire); }
+
+    /**
+     * \return serial of the oldest event still held
+     */
+    uint32_t oldest() const
+    {
+        uint32_t n = written();
+        return n > Events ? n - Events : 0;
+    }
+
+    /**
+     * Stops or restarts recording, so a dump sees a ring that holds still.
+     */
+    void pause(bool paused) { _paused.store(paused, std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> serial; /// Event serial + 1, 0 while empty or being written
+        ScopeTraceEvent event;
+    };
+
+    Slot _slots[Events];
+    std::atomic<uint32_t> _next;
+    std::atomic<bool> _paused;
+};
+
+/**
+ * Records a scope event on the calling task. LogScope calls this; it does
+ * nothing when tracing is compiled out or off target.
+ */
+void scopeTraceRecord(const char *name, char phase);
+
+/**
+ * \see ScopeTraceRing
+ */
+bool scopeTraceRead(uint32_t serial, ScopeTraceEvent &e);
+uint32_t scopeTraceWritten();
+uint32_t scopeTraceOldest();
+void scopeTracePause(bool paused);
+
+/**
+ * Reads a core's cycle counter and the microsecond clock together, so a
+ * dump can put both cores' cycle counts on one timeline.
+ * \param core - core to read, may be the other one
+ * \return false if tracing is not available
+ */
+bool scopeTraceClock(uint8_t core, uint32_t &cycles, int64_t &us);
+
+/**
+ * \return cycle counter rate in MHz, 0 if tracing is not available
+ */
+uint32_t scopeTraceCpuMHz();
+
+/**
+ * Formats one event as a dump line, newline included:
+ *
+ *   T <serial> <core> <B|E> <cycles> <task> <name>
+ *
+ * The name runs to the end of the line and may contain spaces.
+ * scripts/trace_to_chrome.py reads these lines.
+ * \return line length; a long line is cut to size - 1, still ending in a newline
+ */
+size_t scopeTraceFormat(uint32_t serial, const ScopeTraceEvent &e, char *buf, size_t size);
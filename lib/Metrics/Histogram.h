@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Log2 histogram of 32 bit values (normally microseconds) for timing
+ * metrics, with count, sum, min and max.
+ *
+ * Bin 0 holds values below 2^MinBits, bin i holds values below
+ * 2^(MinBits + i), and the last bin holds everything above. add() is O(1),
+ * lock free and doesn't allocate, so one task can record from a time
+ * critical loop while another takes snapshots.
+ *
+ * \tparam Bins    - number of bins
+ * \tparam MinBits - log2 of the upper bound of bin 0
+ */
+template <size_t Bins, unsigned MinBits = 0>
+class Histogram
+{
+    static_assert(Bins >= 2 && MinBits + Bins - 1 <= 32, "Histogram bins must fit 32 bit values");
+
+public:
+    struct Snapshot
+    {
+        uint32_t bins[Bins];
+        uint32_t count;
+        uint32_t sum;
+        uint32_t min; /// 0 if nothing was recorded
+        uint32_t max;
+
+        uint32_t mean() const { return count ? sum / count : 0; }
+
+        /**
+         * Estimates a quantile as the top of the bin holding it, capped at
+         * max, so it is high by less than a factor of two.
+         * \param q - 0..1, e.g. 0.99
+         */
+        uint32_t quantile(float q) const
+        {
+            // Rank of the value wanted, rounded up, 1 based
+            uint32_t rank = (uint32_t)(q * count);
+            if ((rank < q * count) || (rank == 0))
+                rank++;
+
+            uint32_t seen = 0;
+            for (size_t i = 0; i < Bins; i++)
+            {
+                seen += bins[i];
+                if (seen >= rank)
+                {
+                    uint32_t top = upperBound(i) - 1;
+                    return (upperBound(i) == 0 || top > max) ? max : top;
+                }
+            }
+            return max;
+        }
+    };
+
+    Histogram() { reset(); }
+
+    /**
+     * Records a value. Single writer.
+     */
+    void add(uint32_t v)
+    {
+        _bins[binOf(v)].fetch_add(1, std::memory_order_relaxed);
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(v, std::memory_order_relaxed);
+        if (v < _min.load(std::memory_order_relaxed))
+            _min.store(v, std::memory_order_relaxed);
+        if (v > _max.load(std::memory_order_relaxed))
+            _max.store(v, std::memory_order_relaxed);
+    }
+
+    /**
+     * Copies out the values recorded since the last take() and starts over.
+     * A value recorded while this runs may land in either window.
+     */
+    void take(Snapshot &s)
+    {
+        for (size_t i = 0; i < Bins; i++)
+            s.bins[i] = _bins[i].exchange(0, std::memory_order_relaxed);
+        s.count = _count.exchange(0, std::memory_order_relaxed);
+        s.sum = _sum.exchange(0, std::memory_order_relaxed);
+        s.min = _min.exchange(UINT32_MAX, std::memory_order_relaxed);
+        s.max = _max.exchange(0, std::memory_order_relaxed);
+        if (s.min == UINT32_MAX)
+            s.min = 0;
+    }
+
+    void reset()
+    {
+        Snapshot s;
+        take(s);
+    }
+
+    static size_t binOf(uint32_t v)
+    {
+        if (v < (1u << MinBits))
+            return 0;
+        size_t bin = 32 - __builtin_clz(v) - MinBits;
+        return bin < Bins ? bin : Bins - 1;
+    }
+
+    /**
+     * \return exclusive upper bound of a bin, 0 for the open ended last bin
+     */
+    static constexpr uint32_t upperBound(size_t bin)
+    {
+        return (bin + 1 < Bins) ? (uint32_t)1 << (MinBits + bin) : 0;
+    }
+
+    static constexpr size_t bins() { return Bins; }
+
+private:
+    std::atomic<uint32_t> _bins[Bins];
+    std::atomic<uint32_t> _count;
+    std::atomic<uint32_t> _sum;
+    std::atomic<uint32_t> _min;
+    std::atomic<uint32_t> _max;
+};
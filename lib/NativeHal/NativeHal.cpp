@@ -0,0 +1,115 @@
+#include "Arduino.h"
+#include "NativeHal.h"
+
+namespace hal
+{
+    static uint64_t simMicros = 0;
+    static uint8_t pins[PinCount];
+    static AnalogSource analogSource = nullptr;
+
+    void setAnalogSource(AnalogSource source) { analogSource = source; }
+
+    void advanceMicros(uint64_t us) { simMicros += us; }
+
+    uint64_t nowMicros() { return simMicros; }
+
+    uint8_t pinLevel(uint8_t pin) { return pin < PinCount ? pins[pin] : 0; }
+}
+
+HardwareSerial Serial;
+
+unsigned long millis() { return (unsigned long)(hal::simMicros / 1000); }
+
+unsigned long micros() { return (unsigned long)hal::simMicros; }
+
+void delay(unsigned long ms) { hal::advanceMicros((uint64_t)ms * 1000); }
+
+void delayMicroseconds(unsigned int us) { hal::advanceMicros(us); }
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    if (pin < hal::PinCount)
+        hal::pins[pin] = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) { return hal::pinLevel(pin); }
+
+uint16_t analogRead(uint8_t pin) { return hal::analogSource ? hal::analogSource(pin) : 0; }
+
+size_t HardwareSerial::write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--)
+        n += write(*buffer++);
+    return n;
+}
+
+size_t Print::print(long n, int base)
+{
+    if ((base == DEC) && (n < 0))
+        return print('-') + printNumber(-(unsigned long)n, DEC);
+    return printNumber(n, base);
+}
+
+size_t Print::print(unsigned long n, int base) { return printNumber(n, base); }
+
+size_t Print::print(double n, int digits) { return printFloat(n, digits); }
+
+size_t Print::printNumber(unsigned long n, uint8_t base)
+{
+    char buf[8 * sizeof(long) + 1];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    if (base < 2)
+        base = 10;
+    do
+    {
+        char c = n % base;
+        n /= base;
+        *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    return write(str);
+}
+
+size_t Print::printFloat(double number, uint8_t digits)
+{
+    // Same output as the Arduino core, including its nan/inf/ovf strings
+    if (isnan(number))
+        return print("nan");
+    if (isinf(number))
+        return print("inf");
+    if (number > 4294967040.0 || number < -4294967040.0)
+        return print("ovf");
+
+    size_t n = 0;
+    if (number < 0.0)
+    {
+        n += print('-');
+        number = -number;
+    }
+
+    double rounding = 0.5;
+    for (uint8_t i = 0; i < digits; ++i)
+        rounding /= 10.0;
+    number += rounding;
+
+    unsigned long whole = (unsigned long)number;
+    double remainder = number - (double)whole;
+    n += print(whole);
+    if (digits > 0)
+        n += print('.');
+    while (digits-- > 0)
+    {
+        remainder *= 10.0;
+        unsigned int toPrint = (unsigned int)remainder;
+        n += print(toPrint);
+        remainder -= toPrint;
+    }
+    return n;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Simulation hooks behind the host Arduino.h.
+ *
+ * Time only moves when the simulator advances it, so code that waits on
+ * millis() or delayMicroseconds() runs as fast as the host allows.
+ * digitalWrite() levels are kept per pin for the simulator to read back,
+ * and analogRead() asks the simulator for a value.
+ */
+namespace hal
+{
+    /**
+     * Returns the ADC code for a pin, given the current pin levels.
+     */
+    typedef uint16_t (*AnalogSource)(uint8_t pin);
+
+    void setAnalogSource(AnalogSource source);
+
+    /**
+     * Moves simulated time on. delay() and delayMicroseconds() do the same.
+     */
+    void advanceMicros(uint64_t us);
+
+    uint64_t nowMicros();
+
+    /**
+     * \return the last level written to a pin
+     */
+    uint8_t pinLevel(uint8_t pin);
+
+    const uint8_t PinCount = 64;
+}
@@ -0,0 +1,84 @@
+#include "Preferences.h"
+
+#include <map>
+#include <string>
+#include <string.h>
+#include <vector>
+
+struct Preferences::Store
+{
+    std::map<std::string, std::vector<uint8_t>> keys;
+};
+
+namespace
+{
+    std::map<std::string, Preferences::Store> &namespaces()
+    {
+        static std::map<std::string, Preferences::Store> all;
+        return all;
+    }
+}
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partition)
+{
+    _ns = &namespaces()[name];
+    return true;
+}
+
+void Preferences::end()
+{
+    _ns = nullptr;
+}
+
+bool Preferences::isKey(const char *key)
+{
+    return _ns && _ns->keys.count(key);
+}
+
+bool Preferences::remove(const char *key)
+{
+    return _ns && _ns->keys.erase(key);
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len)
+{
+    if (!_ns)
+        return 0;
+    const uint8_t *p = static_cast<const uint8_t *>(value);
+    _ns->keys[key].assign(p, p + len);
+    return len;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen)
+{
+    if (!isKey(key))
+        return 0;
+    const std::vector<uint8_t> &v = _ns->keys[key];
+    if (v.size() > maxLen)
+        return 0;
+    memcpy(buf, v.data(), v.size());
+    return v.size();
+}
+
+size_t Preferences::putInt(const char *key, int32_t value)
+{
+    return putBytes(key, &value, sizeof(value));
+}
+
+int32_t Preferences::getInt(const char *key, int32_t defaultValue)
+{
+    int32_t value;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+size_t Preferences::putBool(const char *key, bool value)
+{
+    uint8_t b = value;
+    return putBytes(key, &b, sizeof(b));
+}
+
+bool Preferences::getBool(const char *key, bool defaultValue)
+{
+    uint8_t b;
+    return getBytes(key, &b, sizeof(b)) == sizeof(b) ? b != 0 : defaultValue;
+}
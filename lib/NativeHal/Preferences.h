@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Host version of the ESP32 Preferences (NVS) class, just the calls the
+ * settings code makes. Keys live in memory for the life of the program,
+ * one store per namespace, so end() and begin() again reads back what was
+ * written, like a reboot would.
+ */
+class Preferences
+{
+public:
+    Preferences() : _ns(nullptr) {}
+
+    bool begin(const char *name, bool readOnly = false, const char *partition = nullptr);
+    void end();
+
+    bool isKey(const char *key);
+    bool remove(const char *key);
+
+    size_t putBytes(const char *key, const void *value, size_t len);
+    size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+    size_t putInt(const char *key, int32_t value);
+    int32_t getInt(const char *key, int32_t defaultValue = 0);
+
+    size_t putBool(const char *key, bool value);
+    bool getBool(const char *key, bool defaultValue = false);
+
+    struct Store; /// Keys of one namespace
+
+private:
+    Store *_ns;
+};
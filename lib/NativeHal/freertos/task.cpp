@@ -0,0 +1,20 @@
+#include "task.h"
+
+#include "../Arduino.h"
+#include "../NativeHal.h"
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stackDepth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    if (handle)
+        *handle = nullptr;
+    return pdFAIL;
+}
+
+void vTaskDelay(TickType_t ticks) { hal::advanceMicros((uint64_t)ticks * portTICK_PERIOD_MS * 1000); }
+
+TickType_t xTaskGetTickCount() { return millis() / portTICK_PERIOD_MS; }
+
+BaseType_t xTaskGetSchedulerState() { return taskSCHEDULER_NOT_STARTED; }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define taskSCHEDULER_NOT_STARTED 1
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stackDepth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+BaseType_t xTaskGetSchedulerState();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * CRC-32 (IEEE 802.3, reflected, as used by zlib).
+ * \param data - bytes to check
+ * \param len - number of bytes
+ * \param crc - running value from a previous call, 0 to start
+ */
+inline uint32_t settingsCrc32(const void *data, size_t len, uint32_t crc = 0)
+{
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  crc = ~crc;
+  while (len--)
+  {
+    crc ^= *p++;
+    for (int b = 0; b < 8; b++)
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+  }
+  return ~crc;
+}
+
+/**
+ * Wraps a plain settings struct with a header and CRC so it can be stored
+ * as one blob (one NVS key, one flash write) and rejected if it is torn,
+ * from another layout version, or from a build with a different size.
+ *
+ * \tparam T       - trivially copyable settings struct
+ * \tparam Version - bump whenever T's layout changes
+ */
+template <typename T, uint16_t Version>
+struct SettingsBlob
+{
+  static const uint32_t Magic = 0x46546847; /// "GhTF"
+
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  T data;
+  uint32_t crc;
+
+  /**
+   * Fills in the header and CRC for the current data.
+   */
+  void seal()
+  {
+    magic = Magic;
+    version = Version;
+    size = sizeof(T);
+    crc = settingsCrc32(this, offsetof(SettingsBlob, crc));
+  }
+
+  /**
+   * \return true if the header matches this build and the CRC is good
+   */
+  bool valid() const
+  {
+    return (magic == Magic) && (version == Version) && (size == sizeof(T)) &&
+           (crc == settingsCrc32(this, offsetof(SettingsBlob, crc)));
+  }
+};
@@ -0,0 +1,226 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Compile-time ADC code -> temperature tables for the floor thermistors.
+ *
+ * The thermistor sits on the low side of a divider with Rref on the high
+ * side, so for an ADC code c out of adcMax:
+ *
+ *     Rt = Rref * c / (adcMax - c)
+ *
+ * Everything here is constexpr so the table is generated by the compiler and
+ * lands in flash; a conversion at runtime is a shift, a mask and at most one
+ * multiply-add. No double or transcendental math on the device.
+ */
+namespace thermistor
+{
+    /// Returned for codes where the sensor reads as a short (too hot to be real)
+    constexpr float kSensorShorted = 998.0f;
+    /// Returned for codes where the sensor reads as open / disconnected
+    constexpr float kSensorOpen = 999.0f;
+
+    constexpr bool isSensorFault(float tempF)
+    {
+        return tempF >= kSensorShorted;
+    }
+
+    /**
+     * Natural log usable in constant expressions.
+     * Range-reduces to [0.75, 1.5) and sums the atanh series.
+     */
+    constexpr double ln(double x)
+    {
+        int k = 0;
+        while (x > 1.5)
+        {
+            x /= 2.0;
+            k++;
+        }
+        while (x < 0.75)
+        {
+            x *= 2.0;
+            k--;
+        }
+
+        double y = (x - 1.0) / (x + 1.0);
+        double y2 = y * y;
+        double term = y;
+        double sum = 0.0;
+        for (int n = 1; n < 41; n += 2)
+        {
+            sum += term / n;
+            term *= y2;
+        }
+        return 2.0 * sum + k * 0.69314718055994530942;
+    }
+
+    /**
+     * Shared O(1) lookup for code-indexed tables: sentinel check, one shift,
+     * and (for StepBits > 0) one interpolation between neighbouring entries.
+     */
+    template <unsigned StepBits>
+    inline float lookupCode(const float *temps, uint32_t firstValid, uint32_t lastValid, uint32_t code)
+    {
+        if (code < firstValid)
+            return kSensorShorted;
+        if (code > lastValid)
+            return kSensorOpen;
+
+        if (StepBits == 0)
+            return temps[code];
+
+        uint32_t idx = code >> StepBits;
+        float frac = (float)(code & ((1u << StepBits) - 1)) * (1.0f / (1u << StepBits));
+        float a = temps[idx];
+        return a + (temps[idx + 1] - a) * frac;
+    }
+
+    /**
+     * One point of a resistance chart, as the table generator read it.
+     */
+    struct ChartPoint
+    {
+        float tempC;
+        float ohms;
+    };
+
+    /**
+     * Code-indexed table whose entries come from outside the compiler, e.g.
+     * SensorChartTable.h generated from the Honeywell resistance chart by
+     * scripts/gen_sensor_table.py. Same layout and lookup as TempTable.
+     */
+    template <unsigned StepBits, unsigned AdcBits = 12>
+    struct ChartTable
+    {
+        static constexpr uint32_t Codes = 1u << AdcBits;
+        static constexpr uint32_t Entries = (Codes >> StepBits) + 1;
+
+        float temps[Entries];
+        uint32_t firstValid;
+        uint32_t lastValid;
+
+        float lookup(uint32_t code) const
+        {
+            return lookupCode<StepBits>(temps, firstValid, lastValid, code);
+        }
+
+        float operator()(uint32_t code) const { return lookup(code); }
+        static constexpr size_t sizeBytes() { return sizeof(float) * Entries; }
+    };
+
+    /**
+     * Beta-equation model of a thermistor divider.
+     */
+    struct BetaModel
+    {
+        double rref;   /// Divider reference resistor (ohms)
+        double ro;     /// Thermistor resistance at To (ohms)
+        double to;     /// Reference temperature (Kelvin)
+        double beta;   /// Beta coefficient
+        double adcMax; /// ADC full scale (codes)
+        double rMin;   /// Below this the sensor is treated as shorted (ohms)
+        double rMax;   /// Above this the sensor is treated as open (ohms)
+    };
+
+    constexpr double resistance(const BetaModel &m, double code)
+    {
+        return m.rref * code / (m.adcMax - code);
+    }
+
+    /**
+     * Reference Beta-equation conversion, in Fahrenheit.
+     * Identical to the original floating point formula; used to build
+     * tables, and by src/bench to measure their error.
+     */
+    constexpr double betaTempF(const BetaModel &m, double code)
+    {
+        return (1.0 / (1.0 / m.to + ln(resistance(m, code) / m.ro) / m.beta) - 273.15) * 9.0 / 5.0 + 32.0;
+    }
+
+    /**
+     * Lookup table indexed by ADC code.
+     *
+     * StepBits = 0 stores one entry per code. StepBits = n stores every 2^n-th
+     * code and linearly interpolates between neighbours, trading a multiply
+     * for a 2^n smaller table.
+     *
+     * Codes outside the model's [rMin, rMax] resistance window hold the
+     * kSensorShorted / kSensorOpen sentinels and are never interpolated.
+     */
+    template <unsigned StepBits, unsigned AdcBits = 12>
+    class TempTable
+    {
+    public:
+        static constexpr uint32_t Codes = 1u << AdcBits;
+        static constexpr uint32_t Step = 1u << StepBits;
+        static constexpr uint32_t Entries = (Codes >> StepBits) + 1;
+
+        constexpr explicit TempTable(const BetaModel &m)
+            : _temps{}, _firstValid(Codes), _lastValid(0)
+        {
+            for (uint32_t code = 1; code < Codes; code++)
+            {
+                double r = resistance(m, code);
+                if (r >= m.rMin && r <= m.rMax)
+                {
+                    if (_firstValid == Codes)
+                        _firstValid = code;
+                    _lastValid = code;
+                }
+            }
+
+            for (uint32_t i = 0; i < Entries; i++)
+            {
+                uint32_t code = i << StepBits;
+                if (code < _firstValid)
+                    _temps[i] = kSensorShorted;
+                else if (code > _lastValid)
+                    _temps[i] = kSensorOpen;
+                else
+                    _temps[i] = (float)betaTempF(m, code);
+            }
+
+            // Interpolation needs real values on both ends of every valid
+            // step, so the bracketing entries hold the physical value
+            // even when they sit just outside the valid window.
+            if (StepBits > 0)
+            {
+                uint32_t lo = _firstValid >> StepBits;
+                uint32_t hi = (_lastValid >> StepBits) + 1;
+                if (hi >= Entries)
+                    hi = Entries - 1;
+                _temps[lo] = (float)betaTempF(m, clampCode(lo << StepBits));
+                _temps[hi] = (float)betaTempF(m, clampCode(hi << StepBits));
+            }
+        }
+
+        /**
+         * Convert a raw ADC code to Fahrenheit.
+         *
+         * \param code - ADC code, clamped to the table range
+         * \return temperature in F, or kSensorShorted / kSensorOpen
+         */
+        float lookup(uint32_t code) const
+        {
+            return lookupCode<StepBits>(_temps, _firstValid, _lastValid, code);
+        }
+
+        float operator()(uint32_t code) const { return lookup(code); }
+
+        constexpr uint32_t firstValidCode() const { return _firstValid; }
+        constexpr uint32_t lastValidCode() const { return _lastValid; }
+        static constexpr size_t sizeBytes() { return sizeof(float) * Entries; }
+
+    private:
+        static constexpr uint32_t clampCode(uint32_t code)
+        {
+            return code < 1 ? 1 : (code > Codes - 1 ? Codes - 1 : code);
+        }
+
+        float _temps[Entries];
+        uint32_t _firstValid;
+        uint32_t _lastValid;
+    };
+}
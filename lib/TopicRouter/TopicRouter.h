@@ -0,0 +1,172 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Handler for a routed MQTT message.
+ *
+ * \param topic - full topic the message arrived on
+ * \param payload - null terminated copy of the payload
+ * \param len - payload length
+ * \param context - value given when the route was added (zone index, log level, ...)
+ */
+typedef void (*TopicHandler)(const char *topic, char *payload, size_t len, intptr_t context);
+
+struct TopicRoute
+{
+    const char *topic;
+    uint32_t hash;
+    uint16_t length;
+    TopicHandler handler;
+    intptr_t context;
+};
+
+/**
+ * Topic -> handler dispatch table built once at start-up.
+ *
+ * Exact topics live in an open-addressed hash table: dispatch hashes the topic
+ * once (FNV-1a, computing the length on the way), probes, and confirms with a
+ * single memcmp, so a lookup is O(topic length) whatever the number of routes.
+ * A handful of MQTT wildcard patterns ('+' and '#') are checked only when no
+ * exact route matches.
+ *
+ * Topic strings are not copied; they must outlive the router (literals,
+ * constexpr tables or static buffers).
+ */
+template <size_t Capacity, size_t MaxPatterns = 4>
+class TopicRouter
+{
+    static_assert(Capacity >= 4 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    TopicRouter() : _count(0), _patternCount(0)
+    {
+        memset(_routes, 0, sizeof(_routes));
+        memset(_patterns, 0, sizeof(_patterns));
+    }
+
+    /**
+     * Route an exact topic. Fails if the topic is already routed or the
+     * table is more than 3/4 full.
+     */
+    bool add(const char *topic, TopicHandler handler, intptr_t context = 0)
+    {
+        if ((_count + 1) * 4 > Capacity * 3)
+            return false;
+
+        size_t length;
+        uint32_t h = hash(topic, &length);
+        for (size_t i = h & (Capacity - 1);; i = (i + 1) & (Capacity - 1))
+        {
+            TopicRoute &r = _routes[i];
+            if (r.topic == NULL)
+            {
+                r = {topic, h, (uint16_t)length, handler, context};
+                _count++;
+                return true;
+            }
+            if (r.hash == h && r.length == length && memcmp(r.topic, topic, length) == 0)
+                return false;
+        }
+    }
+
+    /**
+     * Route an MQTT wildcard pattern, e.g. "floortherm/+/status".
+     */
+    bool addPattern(const char *pattern, TopicHandler handler, intptr_t context = 0)
+    {
+        if (_patternCount >= MaxPatterns)
+            return false;
+        _patterns[_patternCount++] = {pattern, 0, (uint16_t)strlen(pattern), handler, context};
+        return true;
+    }
+
+    /**
+     * Find the route for a topic.
+     * \return the route, or NULL if nothing matches
+     */
+    const TopicRoute *find(const char *topic) const
+    {
+        size_t length;
+        uint32_t h = hash(topic, &length);
+        for (size_t i = h & (Capacity - 1);; i = (i + 1) & (Capacity - 1))
+        {
+            const TopicRoute &r = _routes[i];
+            if (r.topic == NULL)
+                break;
+            if (r.hash == h && r.length == length && memcmp(r.topic, topic, length) == 0)
+                return &r;
+        }
+
+        for (size_t p = 0; p < _patternCount; p++)
+            if (matches(_patterns[p].topic, topic))
+                return &_patterns[p];
+
+        return NULL;
+    }
+
+    /**
+     * Find and invoke the handler for a topic.
+     * \return false if no route matched
+     */
+    bool dispatch(const char *topic, char *payload, size_t len) const
+    {
+        const TopicRoute *r = find(topic);
+        if (r == NULL)
+            return false;
+        r->handler(topic, payload, len, r->context);
+        return true;
+    }
+
+    size_t size() const { return _count + _patternCount; }
+
+    static uint32_t hash(const char *s, size_t *length)
+    {
+        uint32_t h = 2166136261u;
+        const char *p = s;
+        for (; *p != '\0'; p++)
+        {
+            h ^= (uint8_t)*p;
+            h *= 16777619u;
+        }
+        *length = p - s;
+        return h;
+    }
+
+    /**
+     * MQTT topic filter match: '+' matches one level, a trailing '#' matches
+     * the rest (including the parent level itself).
+     */
+    static bool matches(const char *pattern, const char *topic)
+    {
+        while (*pattern != '\0')
+        {
+            if (*pattern == '#')
+                return true;
+
+            if (*pattern == '+')
+            {
+                while (*topic != '\0' && *topic != '/')
+                    topic++;
+                pattern++;
+                continue;
+            }
+
+            if (*topic == '\0')
+                return pattern[0] == '/' && pattern[1] == '#';
+
+            if (*pattern != *topic)
+                return false;
+            pattern++;
+            topic++;
+        }
+        return *topic == '\0';
+    }
+
+private:
+    TopicRoute _routes[Capacity];
+    TopicRoute _patterns[MaxPatterns];
+    size_t _count;
+    size_t _patternCount;
+};
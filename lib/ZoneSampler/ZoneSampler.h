@@ -0,0 +1,113 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Per-zone ring buffer of raw ADC samples with a running-sum moving average.
+ *
+ * The sampler is written by exactly one producer (the background sampling
+ * task) and read by any number of consumers. Consumers only ever see the
+ * latest filtered value per zone, published through an atomic, so reading a
+ * temperature never waits on the ADC.
+ *
+ * No Arduino dependencies, so it builds unchanged for the native target.
+ */
+template <size_t Zones, size_t Depth>
+class ZoneSampler
+{
+public:
+    static_assert(Depth > 0 && Depth <= 255, "Depth must fit in a uint8_t");
+
+    ZoneSampler()
+    {
+        for (size_t z = 0; z < Zones; z++)
+        {
+            _rings[z].head = 0;
+            _rings[z].count = 0;
+            _rings[z].sum = 0;
+            _filtered[z].store(0, std::memory_order_relaxed);
+            _pushes[z].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Add a raw sample for a zone and republish its filtered value.
+     * Producer side only.
+     *
+     * The first sample primes the whole ring so the average is meaningful
+     * straight away instead of ramping up from zero.
+     *
+     * \param zone - zone index, 0 <= zone < Zones
+     * \param raw - raw ADC code
+     * \return void
+     */
+    void push(size_t zone, uint16_t raw)
+    {
+        Ring &r = _rings[zone];
+
+        if (r.count == 0)
+        {
+            for (size_t i = 0; i < Depth; i++)
+                r.samples[i] = raw;
+            r.sum = (uint32_t)raw * Depth;
+            r.count = Depth;
+            r.head = 0;
+        }
+        else
+        {
+            r.sum -= r.samples[r.head];
+            r.samples[r.head] = raw;
+            r.sum += raw;
+            if (++r.head >= Depth)
+                r.head = 0;
+        }
+
+        _filtered[zone].store((uint16_t)(r.sum / Depth), std::memory_order_release);
+        _pushes[zone].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Latest filtered (moving average) ADC code for a zone.
+     * Safe to call from any task.
+     */
+    uint16_t filtered(size_t zone) const
+    {
+        return _filtered[zone].load(std::memory_order_acquire);
+    }
+
+    /**
+     * Total number of samples pushed for a zone since start-up.
+     */
+    uint32_t sampleCount(size_t zone) const
+    {
+        return _pushes[zone].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * True once every zone has received at least one sample.
+     */
+    bool primed() const
+    {
+        for (size_t z = 0; z < Zones; z++)
+            if (sampleCount(z) == 0)
+                return false;
+        return true;
+    }
+
+    static constexpr size_t zones() { return Zones; }
+    static constexpr size_t depth() { return Depth; }
+
+private:
+    struct Ring
+    {
+        uint16_t samples[Depth];
+        uint8_t head;
+        uint8_t count;
+        uint32_t sum;
+    };
+
+    Ring _rings[Zones];
+    std::atomic<uint16_t> _filtered[Zones];
+    std::atomic<uint32_t> _pushes[Zones];
+};
@@ -0,0 +1,180 @@
+"""
+Generates SensorChartTable.h from the Honeywell floor sensor resistance chart.
+
+Runs as a PlatformIO pre: script (writes into $BUILD_DIR/generated and adds it
+to the include path) or standalone:
+
+    python scripts/gen_sensor_table.py <output header>
+
+The chart (Temp C vs Ohms) is read straight from the .xlsx that ships with the
+repo. Between chart points we interpolate linearly in (ln R, 1/T), i.e. a local
+Beta fit per 1 C segment, and sample that at every 2^STEP_BITS ADC codes. The
+firmware then does an O(1) index + one multiply-add per conversion.
+
+The build fails if the table does not reproduce every chart point within
+MAX_CHART_ERROR_F. The chart points go into the header too, so
+test/test_sensor_table can check the C++ lookup against them.
+"""
+
+import math
+import os
+import re
+import sys
+import zipfile
+
+CHART_FILE = "Floor Temp Sensor Resistance Chart.xlsx"
+
+# Must match the divider in src/control.cpp (checked there with static_assert)
+RREF = 10000.0
+ADC_BITS = 12
+STEP_BITS = 2
+R_SHORTED = 500.0
+R_OPEN = 1000000.0
+
+SENSOR_SHORTED = 998.0
+SENSOR_OPEN = 999.0
+MAX_CHART_ERROR_F = 0.25
+
+
+def read_chart(path):
+    """Returns [(kelvin, ohms)] sorted by descending resistance."""
+    with zipfile.ZipFile(path) as xlsx:
+        sheet = xlsx.read("xl/worksheets/sheet1.xml").decode("utf-8")
+
+    points = []
+    for body in re.findall(r"<row [^>]*>(.*?)</row>", sheet):
+        cells = dict(re.findall(r'<c r="([A-Z]+)\d+"[^>]*>(?:<f[^>]*/>|<f[^>]*>[^<]*</f>)?<v>([^<]*)</v></c>', body))
+        if "B" not in cells or "D" not in cells or "t=\"s\"" in body:
+            continue  # header row
+        points.append((float(cells["B"]) + 273.15, float(cells["D"])))
+
+    if len(points) < 2:
+        raise RuntimeError("No resistance data found in " + path)
+    return sorted(points, key=lambda p: -p[1])
+
+
+def chart_temp_f(points, ohms):
+    """Piecewise (ln R, 1/T) interpolation, extrapolating off the ends."""
+    lnr = math.log(ohms)
+    seg = len(points) - 2
+    for i in range(len(points) - 1):
+        if ohms >= points[i + 1][1]:
+            seg = i
+            break
+    (t0, r0), (t1, r1) = points[seg], points[seg + 1]
+    frac = (lnr - math.log(r0)) / (math.log(r1) - math.log(r0))
+    kelvin = 1.0 / (1.0 / t0 + frac * (1.0 / t1 - 1.0 / t0))
+    return (kelvin - 273.15) * 9.0 / 5.0 + 32.0
+
+
+def build_table(points):
+    codes = 1 << ADC_BITS
+    step = 1 << STEP_BITS
+    entries = (codes >> STEP_BITS) + 1
+
+    def resistance(code):
+        code = min(max(code, 1), codes - 1)
+        return RREF * code / (codes - code)
+
+    valid = [c for c in range(1, codes) if R_SHORTED <= resistance(c) <= R_OPEN]
+    first, last = valid[0], valid[-1]
+
+    temps = []
+    for i in range(entries):
+        code = i << STEP_BITS
+        if code < first:
+            temps.append(SENSOR_SHORTED)
+        elif code > last:
+            temps.append(SENSOR_OPEN)
+        else:
+            temps.append(chart_temp_f(points, resistance(code)))
+
+    # Bracketing entries carry real values so interpolation never sees a sentinel
+    lo, hi = first >> STEP_BITS, min((last >> STEP_BITS) + 1, entries - 1)
+    temps[lo] = chart_temp_f(points, resistance(lo << STEP_BITS))
+    temps[hi] = chart_temp_f(points, resistance(hi << STEP_BITS))
+
+    def lookup(code):
+        # Mirrors thermistor::ChartTable::lookup() for a fractional code
+        idx = int(code) >> STEP_BITS
+        frac = (code - (idx << STEP_BITS)) / step
+        return temps[idx] + (temps[idx + 1] - temps[idx]) * frac
+
+    worst = 0.0
+    for kelvin, ohms in points:
+        code = codes * ohms / (ohms + RREF)
+        if first <= code <= last:
+            expected = (kelvin - 273.15) * 9.0 / 5.0 + 32.0
+            worst = max(worst, abs(lookup(code) - expected))
+
+    if worst > MAX_CHART_ERROR_F:
+        raise RuntimeError("Sensor table misses chart by %.3f F (limit %.3f F)" % (worst, MAX_CHART_ERROR_F))
+
+    return temps, first, last, worst
+
+
+def write_header(out_path, chart_path):
+    points = read_chart(chart_path)
+    temps, first, last, worst = build_table(points)
+
+    rows = []
+    for i in range(0, len(temps), 8):
+        rows.append("        " + " ".join("%.3ff," % t for t in temps[i:i + 8]))
+
+    chart = []
+    for i in range(0, len(points), 4):
+        chart.append("            " + " ".join("{%.2ff, %.1ff}," % (k - 273.15, r) for k, r in points[i:i + 4]))
+
+    text = """// Generated by scripts/gen_sensor_table.py from "%s" - do not edit.
+// %d chart points, max error at chart points %.3f F.
+#pragma once
+#include <ThermistorTable.h>
+
+namespace thermistor
+{
+    namespace honeywell
+    {
+        constexpr double Rref = %.1f;
+
+        constexpr ChartTable<%d, %d> table = {
+            {
+%s
+            },
+            %d,
+            %d,
+        };
+
+        // The chart the table was built from, for test/test_sensor_table
+        constexpr ChartPoint chart[] = {
+%s
+        };
+    }
+}
+""" % (os.path.basename(chart_path), len(points), worst, RREF, STEP_BITS, ADC_BITS,
+       "\n".join("    " + r for r in rows), first, last, "\n".join(chart))
+
+    os.makedirs(os.path.dirname(os.path.abspath(out_path)), exist_ok=True)
+    if os.path.exists(out_path) and open(out_path).read() == text:
+        return worst
+    with open(out_path, "w") as f:
+        f.write(text)
+    return worst
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+except NameError:
+    env = None
+
+if env is not None:
+    project_dir = env.subst("$PROJECT_DIR")
+    gen_dir = os.path.join(env.subst("$BUILD_DIR"), "generated")
+    worst = write_header(os.path.join(gen_dir, "SensorChartTable.h"), os.path.join(project_dir, CHART_FILE))
+    print("Sensor chart table generated, max chart error %.3f F" % worst)
+    env.Append(CPPPATH=[gen_dir])
+elif __name__ == "__main__":
+    if len(sys.argv) != 2:
+        sys.exit("usage: gen_sensor_table.py <output header>")
+    here = os.path.dirname(os.path.abspath(__file__))
+    worst = write_header(sys.argv[1], os.path.join(here, "..", CHART_FILE))
+    print("max chart error %.3f F" % worst)
@@ -0,0 +1,124 @@
+"""
+Decodes zone history (floortherm/sys/history/get replies) into CSV.
+
+    mosquitto_sub -t floorthermhist/0 -F %x -C 1000 > capture.hex &
+    mosquitto_pub -t floortherm/sys/history/get -m "0 1700000000 1700086400"
+    python scripts/history_decode.py capture.hex --zones MBR,NAV,OFC,SMV,MAV
+
+Input is one reply message per line in hex, as printed by mosquitto_sub -F
+%x, or stdin if no file is given. --segment reads a raw segment file copied
+off the device's /history directory instead.
+
+Prints time,zone,temp,setTemp,heating rows. Block layout is documented in
+lib/History/HistoryBlock.h, the reply message header in src/main.cpp.
+"""
+
+import argparse
+import struct
+import sys
+from datetime import datetime, timezone
+
+BLOCK_VERSION = 1
+BLOCK_BYTES = 512
+HEADER = struct.Struct("<BBHHHII")
+CHUNK = struct.Struct("<HH")
+CHUNK_LAST = 0x0001
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def signed(self):
+        v = shift = 0
+        while True:
+            b = self.data[self.pos]
+            self.pos += 1
+            v |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                return (v >> 1) ^ -(v & 1)
+
+    def bitmap(self, zones):
+        n = (zones + 7) // 8
+        bits = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return [bool(bits[i // 8] >> (i % 8) & 1) for i in range(zones)]
+
+
+def decode_block(block):
+    """Yields (time, temps, setTemps, heating) for every sample in a block."""
+    version, zones, count, used, _, first_time, _ = HEADER.unpack_from(block)
+    if version != BLOCK_VERSION:
+        raise ValueError(f"unknown block version {version}")
+    rd = Reader(block[HEADER.size:HEADER.size + used])
+
+    t = first_time + rd.signed()
+    temps = [rd.signed() for _ in range(zones)]
+    sets = [rd.signed() for _ in range(zones)]
+    heating = rd.bitmap(zones)
+    yield t, temps, sets, heating
+
+    delta = 0
+    for _ in range(count - 1):
+        delta += rd.signed()
+        t += delta
+        temps = [v + rd.signed() for v in temps]
+        changed = rd.bitmap(zones)
+        sets = [v + rd.signed() if c else v for v, c in zip(sets, changed)]
+        heating = rd.bitmap(zones)
+        yield t, temps, sets, heating
+
+
+def blocks_from_replies(lines):
+    expected = 0
+    for line in lines:
+        line = line.strip()
+        if not line:
+            continue
+        msg = bytes.fromhex(line)
+        seq, flags = CHUNK.unpack_from(msg)
+        if seq != expected:
+            print(f"# missing reply messages {expected}..{seq - 1}", file=sys.stderr)
+        expected = seq + 1
+        if flags & CHUNK_LAST:
+            expected = 0
+            continue
+        yield msg[CHUNK.size:]
+
+
+def blocks_from_segment(data):
+    for pos in range(0, len(data) - BLOCK_BYTES + 1, BLOCK_BYTES):
+        yield data[pos:pos + BLOCK_BYTES]
+
+
+def main(argv):
+    ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    ap.add_argument("capture", nargs="?", help="hex reply capture (default stdin)")
+    ap.add_argument("--segment", action="store_true", help="capture is a raw segment file")
+    ap.add_argument("--zones", help="comma separated zone names, in board order")
+    args = ap.parse_args(argv[1:])
+
+    if args.segment:
+        with open(args.capture, "rb") as f:
+            blocks = blocks_from_segment(f.read())
+    elif args.capture:
+        with open(args.capture) as f:
+            blocks = list(blocks_from_replies(f))
+    else:
+        blocks = blocks_from_replies(sys.stdin)
+
+    names = args.zones.split(",") if args.zones else None
+    print("time,zone,temp,setTemp,heating")
+    for block in blocks:
+        for t, temps, sets, heating in decode_block(block):
+            stamp = datetime.fromtimestamp(t, timezone.utc).strftime("%Y-%m-%dT%H:%M:%SZ")
+            for i, (temp, st, heat) in enumerate(zip(temps, sets, heating)):
+                zone = names[i] if names and i < len(names) else f"Z{i}"
+                print(f"{stamp},{zone},{temp / 10:.1f},{st},{int(heat)}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,218 @@
+"""
+Decodes binary log records (Log.setBinary(true)) back into text.
+
+    python scripts/log_decode.py .pio/build/esp32dev/firmware.elf [capture]
+
+Reads the capture file, or stdin if none is given (e.g. piped from a serial
+terminal in raw mode). Format strings and scope names are not sent by the
+device, only their addresses, so the ELF must be the exact firmware that
+produced the log.
+
+Records are COBS framed and end in a zero byte; see lib/Logger/LogBinary.h for
+the layout. Anything that doesn't decode (boot ROM text, a partial first
+frame) is passed through as text.
+"""
+
+import math
+import struct
+import sys
+
+RECORD_VERSION = 1
+LEVELS = "?FEWITV"
+DEFAULT_SCOPE = "FloorTherm"
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+
+class Elf:
+    """Just enough ELF to read NUL terminated strings by address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF":
+            raise ValueError(f"{path} is not an ELF file")
+        endian = "<" if self.data[5] == 1 else ">"
+        if self.data[4] == 1:
+            shoff, = struct.unpack_from(endian + "I", self.data, 0x20)
+            shentsize, shnum = struct.unpack_from(endian + "HH", self.data, 0x2E)
+            section = endian + "IIIIII"
+        else:
+            # 64-bit, for host builds
+            shoff, = struct.unpack_from(endian + "Q", self.data, 0x28)
+            shentsize, shnum = struct.unpack_from(endian + "HH", self.data, 0x3A)
+            section = endian + "IIQQQQ"
+        self.sections = []
+        for i in range(shnum):
+            _, stype, flags, addr, offset, size = struct.unpack_from(
+                section, self.data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and stype != SHT_NOBITS and size:
+                self.sections.append((addr, size, offset))
+
+    def string(self, addr):
+        for start, size, offset in self.sections:
+            if start <= addr < start + size:
+                pos = offset + addr - start
+                end = self.data.index(b"\0", pos)
+                return self.data[pos:end].decode("latin-1")
+        return f"<0x{addr:08x}?>"
+
+
+def cobs_decode(frame):
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame):
+            raise ValueError("bad COBS frame")
+        out += frame[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def u8(self):
+        v = self.data[self.pos]
+        self.pos += 1
+        return v
+
+    def u32(self):
+        v, = struct.unpack_from("<I", self.data, self.pos)
+        self.pos += 4
+        return v
+
+    def varint(self):
+        v = shift = 0
+        while True:
+            b = self.u8()
+            v |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                return v
+
+    def signed(self):
+        v = self.varint()
+        return (v >> 1) ^ -(v & 1)
+
+    def float(self):
+        v, = struct.unpack_from("<f", self.data, self.pos)
+        self.pos += 4
+        return v
+
+    def string(self, elf):
+        if self.u8() == 0:
+            return elf.string(self.u32())
+        n = self.u8()
+        s = self.data[self.pos:self.pos + n].decode("latin-1")
+        self.pos += n
+        return s
+
+
+def print_double(v):
+    # Same output as Arduino Print::print(double) with 2 digits
+    if math.isnan(v):
+        return "nan"
+    if math.isinf(v):
+        return "inf"
+    if abs(v) > 4294967040.0:
+        return "ovf"
+    return f"{v:.2f}"
+
+
+def render(fmt, rd, elf):
+    """Formats like Logging::printFormat() in lib/Logger/Logger.cpp."""
+    out = []
+    i = 0
+    while i < len(fmt):
+        c = fmt[i]
+        i += 1
+        if c != "%":
+            out.append(c)
+            continue
+        if i >= len(fmt):
+            break
+        spec = fmt[i]
+        i += 1
+        if spec == "%":
+            out.append("%")
+        elif spec in "di":
+            out.append(str(rd.signed()))
+        elif spec == "l":
+            out.append(str(rd.signed()))
+        elif spec == "u":
+            out.append(str(rd.varint()))
+        elif spec in "DF":
+            out.append(print_double(rd.float()))
+        elif spec == "x":
+            out.append(f"{rd.signed() & 0xFFFFFFFF:X}")
+        elif spec == "X":
+            h = rd.signed() & 0xFFFF
+            pad = (h < 0xFFF) + (h < 0xFF) + (h < 0xF)
+            out.append("0x" + "0" * pad + f"{h:X}")
+        elif spec == "b":
+            out.append(f"{rd.signed() & 0xFFFFFFFF:b}")
+        elif spec == "B":
+            out.append(f"0b{rd.signed() & 0xFFFFFFFF:b}")
+        elif spec == "c":
+            out.append(chr(rd.signed() & 0xFF))
+        elif spec == "C":
+            ch = rd.signed() & 0xFF
+            if 0x20 <= ch < 0x7F:
+                out.append(chr(ch))
+            else:
+                out.append("0x" + ("0" if ch < 0xF else "") + f"{ch:X}")
+        elif spec == "t":
+            out.append("T" if rd.signed() == 1 else "F")
+        elif spec == "T":
+            out.append("true" if rd.signed() == 1 else "false")
+        elif spec in "sSp":
+            out.append(rd.string(elf))
+    return "".join(out)
+
+
+def decode_record(record, elf):
+    rd = Reader(record)
+    head = rd.u8()
+    if head >> 4 != RECORD_VERSION:
+        raise ValueError(f"unknown record version {head >> 4}")
+    level = head & 0x0F
+    millis = rd.varint()
+    fmt = elf.string(rd.u32())
+    scope_addr = rd.u32()
+    scope = elf.string(scope_addr) if scope_addr else DEFAULT_SCOPE
+    text = render(fmt, rd, elf)
+    return f"{millis:10d} : {scope}: {LEVELS[level]}: {text}"
+
+
+def main(argv):
+    if len(argv) < 2:
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+    elf = Elf(argv[1])
+    if len(argv) > 2:
+        with open(argv[2], "rb") as f:
+            stream = f.read()
+    else:
+        stream = sys.stdin.buffer.read()
+
+    for frame in stream.split(b"\0"):
+        if not frame:
+            continue
+        try:
+            line = decode_record(cobs_decode(frame), elf)
+        except (ValueError, IndexError, struct.error):
+            # Not a record - boot messages and the like
+            line = frame.decode("latin-1", "replace").rstrip("\r\n")
+        print(line)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,137 @@
+"""
+Converts a scope trace dump (floortherm/sys/trace/get) to Chrome trace JSON.
+
+    mosquitto_sub -t floorthermtrace/0 > trace.txt &
+    mosquitto_pub -t floortherm/sys/trace/get -m "0"
+    python scripts/trace_to_chrome.py trace.txt -o trace.json
+
+"0 serial" dumps to the serial port instead; a serial capture works as is,
+log lines around the dump are skipped. Open the JSON in chrome://tracing or
+ui.perfetto.dev: one process per core, one thread per task, one slice per
+LogScope and per task loop pass.
+
+Dump lines are documented in lib/Logger/ScopeTrace.h. Each core's cycle
+counter is put on the microsecond clock read when the dump started, so the
+times are microseconds since boot. Cycle counts are 32 bits and unwrapped
+from one event to the next, which holds as long as a core records something
+at least every 2^31 cycles (about 9 s at 240 MHz).
+"""
+
+import argparse
+import json
+import sys
+
+
+def parse(lines):
+    """Returns (header, clocks, events) of the last complete dump."""
+    dump = None
+    done = None
+    for line in lines:
+        line = line.rstrip("\r\n")
+        if line.startswith("#T trace "):
+            first, end, mhz = (int(v) for v in line.split()[2:5])
+            dump = {"first": first, "end": end, "mhz": mhz, "clocks": {}, "events": []}
+        elif dump is None:
+            continue
+        elif line.startswith("#T clock "):
+            core, cycles, us = (int(v) for v in line.split()[2:5])
+            dump["clocks"][core] = (cycles, us)
+        elif line.startswith("#T end"):
+            done = dump
+            dump = None
+        elif line.startswith("T "):
+            parts = line.split(" ", 6)
+            if len(parts) < 7:
+                continue
+            _, serial, core, phase, cycles, task, name = parts
+            dump["events"].append((int(serial), int(core), phase, int(cycles), task, name))
+
+    if done is None and dump is not None:
+        print("# dump incomplete, converting what arrived", file=sys.stderr)
+        done = dump
+    return done
+
+
+def signed32(v):
+    v &= 0xFFFFFFFF
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def to_chrome(dump):
+    mhz = dump["mhz"]
+    events = sorted(dump["events"])
+    missing = (dump["end"] - dump["first"]) - len(events)
+    if missing > 0:
+        print(f"# {missing} events lost or half written", file=sys.stderr)
+
+    # Unwrap each core's cycle count, then hang it off that core's clock
+    unwrapped = []
+    last = {}
+    for serial, core, phase, cycles, task, name in events:
+        if core in last:
+            prev_raw, prev = last[core]
+            t = prev + signed32(cycles - prev_raw)
+        else:
+            t = cycles
+        last[core] = (cycles, t)
+        unwrapped.append((core, phase, t, task, name))
+
+    offsets = {}
+    for core, (ref_raw, ref_us) in dump["clocks"].items():
+        if core in last:
+            prev_raw, prev = last[core]
+            offsets[core] = ref_us - (prev + signed32(ref_raw - prev_raw)) / mhz
+    for core in last:
+        if core not in offsets:
+            print(f"# no clock for core {core}, its times are relative", file=sys.stderr)
+            offsets[core] = 0
+
+    tids = {}
+    out = []
+    open_scopes = {}
+    for core, phase, t, task, name in unwrapped:
+        key = (core, task)
+        if key not in tids:
+            tids[key] = len(tids) + 1
+            out.append({"ph": "M", "name": "thread_name", "pid": core, "tid": tids[key], "args": {"name": task}})
+        depth = open_scopes.get(key, 0)
+        if phase == "E":
+            # Its begin was overwritten before the dump
+            if depth == 0:
+                continue
+            open_scopes[key] = depth - 1
+        else:
+            open_scopes[key] = depth + 1
+        out.append({"ph": phase, "name": name, "pid": core, "tid": tids[key], "ts": offsets[core] + t / mhz})
+
+    for core in sorted(last):
+        out.append({"ph": "M", "name": "process_name", "pid": core, "args": {"name": f"core {core}"}})
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+
+def main(argv):
+    ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    ap.add_argument("capture", nargs="?", help="dump capture, MQTT or serial (default stdin)")
+    ap.add_argument("-o", "--output", help="JSON file to write (default stdout)")
+    args = ap.parse_args(argv[1:])
+
+    if args.capture:
+        with open(args.capture, errors="replace") as f:
+            dump = parse(f)
+    else:
+        dump = parse(sys.stdin)
+    if dump is None:
+        print("no trace dump found", file=sys.stderr)
+        return 1
+
+    trace = to_chrome(dump)
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
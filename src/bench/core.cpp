@@ -0,0 +1,237 @@
+#include <Arduino.h>
+#include <Logger.h>
+#include "Control.h"
+#include "Status.h"
+#include "CoreBench.h"
+#include "Topics.h"
+#include <TopicRouter.h>
+#include <HistoryBlock.h>
+
+// ********************* Benchmark Parameters ************************
+#define BENCH_CONVERT_OPS 20000 /// ConvertValToTemp() calls, across every ADC code
+#define BENCH_BETA_OPS 4000     /// Conversions with the old log() formula
+#define BENCH_LOG_OPS 2000      /// Formatted log lines
+#define BENCH_STATUS_OPS 1000   /// Status documents built and cached
+#define BENCH_ROUTER_OPS 20000  /// Router lookups over the mixed message stream
+#define BENCH_HISTORY_OPS 10080 /// History samples, a week at one a minute
+#define BENCH_HISTORY_EPOCH 1700000000 /// Time of the first sample
+
+const BenchMessage benchMessages[] = {
+    {statusTopic, "{}"},
+    {zoneTable.statusTopic[0].c_str(), "{}"},
+    {statusTopic, "{}"},
+    {zoneTable.statusTopic[ZONE_COUNT - 1].c_str(), "{}"},
+    {metricsTopic, "{}"},
+    {statusTopic, "{}"},
+    {zoneTable.setPointTopic[0].c_str(), "72"},
+    {controlMetricsTopic, "{}"},
+    {zoneTable.enableTopic[ZONE_COUNT - 1].c_str(), "1"},
+    {"floortherm/alarm/ZNX", "OVERHEATING"},
+    {getStatusTopic, ""},
+    {metricsGetTopic, "99"},
+    {"floortherm/sys/log/info", "99"},
+    {historyGetTopic, "99"},
+    {statusTopic, "{}"},
+    {aliveTopic, "99"}};
+const size_t benchMessageCount = sizeof(benchMessages) / sizeof(benchMessages[0]);
+
+// ConvertValToTemp() before the tables: the Beta equation with a log()
+// per call, in float as the original was
+static float betaFormulaTemp(int Vo)
+{
+  const thermistor::BetaModel &m = floorSensorModel;
+  float Rt = m.rref * Vo / (m.adcMax - Vo);
+  float T = 1 / (1 / m.to + log(Rt / m.ro) / m.beta);
+  return (T - 273.15) * 9 / 5 + 32;
+}
+
+// Largest difference from thermistor::betaTempF() over the valid codes
+template <typename Convert>
+static double maxErrorF(Convert convert, uint32_t first, uint32_t last)
+{
+  double worst = 0;
+  for (uint32_t code = first; code <= last; code++)
+  {
+    double err = fabs(convert(code) - thermistor::betaTempF(floorSensorModel, code));
+    if (err > worst)
+      worst = err;
+  }
+  return worst;
+}
+
+static void benchRouted(const char *topic, char *payload, size_t len, intptr_t context)
+{
+  benchKeep(context);
+}
+
+static void benchRouter(Bench &bench)
+{
+  // The routes setupTopicRoutes() in main.cpp adds, for a router of our own
+  static TopicRouter<TOPIC_ROUTES> router;
+  for (const TopicRouteDef &route : topicRoutes)
+  {
+    if (route.pattern)
+      router.addPattern(route.topic, benchRouted, route.context);
+    else
+      router.add(route.topic, benchRouted, route.context);
+  }
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    router.add(zoneTable.setPointTopic[i].c_str(), benchRouted, i);
+    router.add(zoneTable.enableTopic[i].c_str(), benchRouted, i);
+  }
+
+  // Patterns are only tried after an exact miss, so the zone status
+  // echoes set the worst case
+  bench.runEach("TopicRouter::dispatch mixed", BENCH_ROUTER_OPS, []()
+                {
+                  static size_t next = 0;
+                  const BenchMessage &m = benchMessages[next++ % benchMessageCount];
+                  char payload[16];
+                  size_t len = strlen(m.payload);
+                  memcpy(payload, m.payload, len + 1);
+                  benchKeep(router.dispatch(m.topic, payload, len)); });
+}
+
+// Synthetic zones for the history encoder: floors that cool slowly, heat
+// back up past the set point and drop to a setback overnight, one sample
+// a minute as serviceHistory() records them
+struct BenchFloors
+{
+  float temp[ZONE_COUNT];
+  uint32_t noise;
+
+  BenchFloors() : noise(1)
+  {
+    for (size_t i = 0; i < ZONE_COUNT; i++)
+      temp[i] = 66.0f + i;
+  }
+
+  void next(HistorySample<ZONE_COUNT> &s, uint32_t minute)
+  {
+    bool night = (minute % 1440) < 360;
+    s.time = BENCH_HISTORY_EPOCH + minute * 60;
+    for (size_t i = 0; i < ZONE_COUNT; i++)
+    {
+      s.setTemp[i] = night ? 64 : 70 + (i % 4);
+      if (temp[i] < s.setTemp[i] - 0.5f)
+        s.heating[i] = true;
+      else if (temp[i] > s.setTemp[i] + 0.5f)
+        s.heating[i] = false;
+
+      noise = noise * 1103515245 + 12345;
+      temp[i] += (s.heating[i] ? 0.03f : -0.01f) + ((int)((noise >> 16) % 5) - 2) * 0.01f;
+      s.temp[i] = lroundf(temp[i] * 10);
+    }
+  }
+};
+
+// A week of samples through the block encoder, full blocks sealed and a
+// new one started as HistoryStore::record() does. Samples are made
+// between the timed appends, and bytes are counted the way
+// HistoryStore::bytesPerSample() counts them, block headers included.
+static void benchHistory(Bench &bench)
+{
+  static HistoryBlockWriter<ZONE_COUNT> writer;
+  static BenchFloors floors;
+  HistorySample<ZONE_COUNT> s = {};
+  uint32_t sealedBytes = 0;
+  uint32_t blocks = 0;
+
+  uint32_t allocs = allocCountTotal();
+  BenchTicks elapsed = 0;
+  BenchTicks worst = 0;
+  for (uint32_t minute = 0; minute < BENCH_HISTORY_OPS; minute++)
+  {
+    floors.next(s, minute);
+
+    BenchTicks start = benchTicks();
+    if (!writer.append(s))
+    {
+      sealedBytes += sizeof(HistoryBlockHeader) + writer.header().used;
+      blocks++;
+      writer.reset();
+      writer.append(s);
+    }
+    BenchTicks ticks = benchTicks() - start;
+    elapsed += ticks;
+    if (ticks > worst)
+      worst = ticks;
+  }
+  allocs = allocCountTotal() - allocs;
+  bench.report("HistoryBlockWriter::append", BENCH_HISTORY_OPS, elapsed, allocs, worst);
+
+  uint32_t bytes = sealedBytes + sizeof(HistoryBlockHeader) + writer.header().used;
+  bench.note("history bytes/sample", "%.2f, %lu blocks a week, raw sample %u", (double)bytes / BENCH_HISTORY_OPS,
+             (unsigned long)blocks + 1, (unsigned)sizeof(HistorySample<ZONE_COUNT>));
+}
+
+void benchCore(Bench &bench)
+{
+  bench.run("ConvertValToTemp", BENCH_CONVERT_OPS, []()
+            {
+              static int code = 0;
+              code = (code + 1) & 4095;
+              benchKeep(ConvertValToTemp(code)); });
+
+  // Same codes through the formula the table replaced
+  static const thermistor::TempTable<2> betaTable(floorSensorModel);
+  const uint32_t first = betaTable.firstValidCode();
+  const uint32_t last = betaTable.lastValidCode();
+  bench.run("Beta formula, log()", BENCH_BETA_OPS, [=]()
+            {
+              static uint32_t code = 0;
+              code = (code + 1) & 4095;
+              benchKeep(betaFormulaTemp(constrain(code, first, last))); });
+
+  // Interpolation error of the Beta table (THERMISTOR_BETA_MODEL builds),
+  // and how far the default chart table sits from the Beta equation
+  bench.note("TempTable<2> error", "max %.3f F over codes %lu..%lu", maxErrorF(betaTable, first, last),
+             (unsigned long)first, (unsigned long)last);
+  bench.note("ConvertValToTemp vs Beta", "max %.3f F", maxErrorF(ConvertValToTemp, first, last));
+
+  // A logger of its own, so the lines go nowhere and the real log level,
+  // prefix and output don't change
+  static BenchSink sink;
+  static Logging benchLog;
+  benchLog.begin(LOG_LEVEL_VERBOSE, &sink, false);
+
+  // The per-zone status line logHeatingStatus() writes
+  bench.run("Logging::print", BENCH_LOG_OPS, []()
+            { benchLog.infoln("%s: Enabled: %T     Current: %F     Target: %i     Heating: %s     %s",
+                              zoneTable.name(0), true, 71.25f, 72, "HEATING", ""); });
+  benchKeep(sink.bytes());
+
+  benchRouter(bench);
+  benchHistory(bench);
+
+  // Status publish as the tasks do it: the control task publishes the
+  // zone state, the UI task asks for the cached document. zones[] is put
+  // back afterwards, since the board runs this before its tasks start.
+  static ZoneState saved[ZONE_COUNT];
+  memcpy(saved, zones, sizeof(zones));
+
+  static char json[STATUS_JSON_MAX];
+  ZoneSnapshot zs = zoneState.read();
+  bench.run("getStatusJson", BENCH_STATUS_OPS, [&]()
+            { benchKeep(getStatusJson(zs, json, sizeof(json))); });
+
+  // A reading moved every pass, so every document is built again
+  bench.run("status publish, changed", BENCH_STATUS_OPS, []()
+            {
+              static int step = 0;
+              zones[0].actualTemp = 70.0f + 0.05f * (++step & 15);
+              publishZoneState();
+              size_t len;
+              benchKeep(cachedStatusJson(len)); });
+
+  // Nothing moved, the cached document goes out again
+  bench.run("status publish, unchanged", BENCH_STATUS_OPS, []()
+            {
+              publishZoneState();
+              size_t len;
+              benchKeep(cachedStatusJson(len)); });
+
+  memcpy(zones, saved, sizeof(zones));
+  publishZoneState();
+}
@@ -0,0 +1,181 @@
+// Host benchmarks: the code in CoreBench.h, timed on the build machine.
+//
+//   pio run -e native-bench && .pio/build/native-bench/program
+//
+// The board runs the full set, MQTT callback and display included, from
+// [env:esp32dev-bench].
+
+#include <Arduino.h>
+#include <Logger.h>
+#include <AsyncLogOutput.h>
+#include <atomic>
+#include <new>
+#include <thread>
+#include "Control.h"
+#include "CoreBench.h"
+
+// ********************* Benchmark Parameters ************************
+#define BENCH_LOG_PRODUCERS 4      /// Tasks logging at once
+#define BENCH_LOG_LINES 50000      /// Lines each producer pushes
+#define BENCH_LOG_LINE_BYTES 64    /// A typical formatted line
+
+// libstdc++ calls malloc from inside the shared library, out of reach of
+// --wrap=malloc, so send new through our malloc to count it too
+void *operator new(size_t size)
+{
+  void *p = malloc(size);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, size_t size) noexcept
+{
+  free(p);
+}
+
+struct LogProducer
+{
+  BenchTicks busy;
+  BenchTicks worst;
+  uint32_t full; /// Pushes refused because the ring was full
+};
+
+/**
+ * Several threads push lines into the ring AsyncLogOutput uses while one
+ * drains it the way its task does, as fast as they all can. A producer
+ * that finds the ring full yields and tries again rather than dropping
+ * the line, so every line comes out and the run measures how many lines
+ * the ring moves. Reports the caller's cost per push and the lines per
+ * second, and checks each drained line is whole and in order for its
+ * producer.
+ * \return false if a line went missing, came out torn or out of order
+ */
+static bool benchLogRing(Bench &bench)
+{
+  static LogRing<LOG_RING_SLOTS, LOG_LINE_MAX> ring;
+  static LogProducer producers[BENCH_LOG_PRODUCERS];
+  std::atomic<bool> go(false);
+  std::atomic<int> running(BENCH_LOG_PRODUCERS);
+  uint32_t drained = 0;
+  uint32_t bad = 0;
+
+  std::thread drain([&]()
+                    {
+                      static char chunk[LOG_DRAIN_CHUNK];
+                      BenchSink sink;
+                      int32_t last[BENCH_LOG_PRODUCERS];
+                      for (int p = 0; p < BENCH_LOG_PRODUCERS; p++)
+                        last[p] = -1;
+                      for (;;)
+                      {
+                        bool finished = running.load() == 0;
+                        size_t used = 0;
+                        while (sizeof(chunk) - used >= LOG_LINE_MAX)
+                        {
+                          size_t len = ring.pop(chunk + used);
+                          if (len == 0)
+                            break;
+                          // "<producer> <serial> xxx...x\n"
+                          int p = -1;
+                          long serial = -1;
+                          bool whole = (len == BENCH_LOG_LINE_BYTES) && (chunk[used + len - 1] == '\n') &&
+                                       (sscanf(chunk + used, "%d %ld", &p, &serial) == 2) &&
+                                       (p >= 0) && (p < BENCH_LOG_PRODUCERS);
+                          if (!whole || (serial <= last[p]))
+                            bad++;
+                          else
+                            last[p] = serial;
+                          drained++;
+                          used += len;
+                        }
+                        sink.write((const uint8_t *)chunk, used);
+                        if (used == 0)
+                        {
+                          if (finished)
+                            break;
+                          std::this_thread::yield();
+                        }
+                      } });
+
+  std::thread threads[BENCH_LOG_PRODUCERS];
+  for (int p = 0; p < BENCH_LOG_PRODUCERS; p++)
+  {
+    threads[p] = std::thread([&, p]()
+                             {
+                               LogProducer &me = producers[p];
+                               char line[BENCH_LOG_LINE_BYTES];
+                               memset(line, 'x', sizeof(line));
+                               line[sizeof(line) - 1] = '\n';
+                               while (!go.load())
+                                 std::this_thread::yield();
+                               for (uint32_t i = 0; i < BENCH_LOG_LINES; i++)
+                               {
+                                 int n = snprintf(line, sizeof(line), "%d %lu ", p, (unsigned long)i);
+                                 line[n] = 'x';
+                                 for (;;)
+                                 {
+                                   BenchTicks start = benchTicks();
+                                   bool ok = ring.push(line, sizeof(line));
+                                   BenchTicks ticks = benchTicks() - start;
+                                   me.busy += ticks;
+                                   if (ticks > me.worst)
+                                     me.worst = ticks;
+                                   if (ok)
+                                     break;
+                                   me.full++;
+                                   std::this_thread::yield();
+                                 }
+                               }
+                               running--; });
+  }
+
+  // Thread start-up allocates, so only count from here
+  uint32_t allocs = allocCountTotal();
+  BenchTicks start = benchTicks();
+  go = true;
+  for (std::thread &t : threads)
+    t.join();
+  drain.join();
+  BenchTicks elapsed = benchTicks() - start;
+  allocs = allocCountTotal() - allocs;
+
+  BenchTicks busy = 0;
+  BenchTicks worst = 0;
+  uint32_t full = 0;
+  for (const LogProducer &p : producers)
+  {
+    busy += p.busy;
+    worst = p.worst > worst ? p.worst : worst;
+    full += p.full;
+  }
+  const uint32_t lines = BENCH_LOG_PRODUCERS * BENCH_LOG_LINES;
+
+  // Caller cost per push attempt, then lines through the ring per second
+  char name[32];
+  snprintf(name, sizeof(name), "LogRing::push, %d producers", BENCH_LOG_PRODUCERS);
+  bench.report(name, lines + full, busy, allocs, worst);
+  bench.note("LogRing throughput", "%.0f lines/s, %.1f%% of pushes found the ring full",
+             lines * 1e9 / benchTicksToNs(elapsed), 100.0 * full / (lines + full));
+  bench.note("LogRing check", "%lu of %lu lines drained, %lu torn or out of order", (unsigned long)drained,
+             (unsigned long)lines, (unsigned long)bad);
+  return (bad == 0) && (drained == lines);
+}
+
+int main(int argc, char **argv)
+{
+  Log.begin(LOG_LEVEL_WARNING, &Serial);
+  initZones();
+
+  Bench bench(&Serial);
+  bench.begin();
+  benchCore(bench);
+  bench.skip("onMqttMessage", "board only, the router alone is above");
+  bench.skip("displayHeatingStatus", "board only");
+  return benchLogRing(bench) ? 0 : 1;
+}
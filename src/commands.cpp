@@ -0,0 +1,134 @@
+#include <Arduino.h>
+#include <Logger.h>
+#include <LogScope.h>
+#include <ArduinoJson.h>
+#include "Commands.h"
+#include "Settings.h"
+#include "Status.h"
+
+const int bulkDocCapacity = JSON_OBJECT_SIZE(BULK_ZONES_MAX) + BULK_ZONES_MAX * JSON_OBJECT_SIZE(2);
+
+SpscQueue<ZoneCommand, ZONE_COMMAND_QUEUE> zoneCommands;
+std::atomic<bool> statusPublishPending(false);
+std::atomic<bool> bulkStatusPending(false);
+
+void queueZoneCommand(const ZoneCommand &cmd)
+{
+  if (!zoneCommands.push(cmd))
+    LOG_WARNINGLN("Zone command queue full, dropping command");
+}
+
+void applyZoneCommands()
+{
+  LogScope scope("applyZoneCommands()");
+  LOG_VERBOSELN("Entering...");
+
+  // Control task only - the sole writer of zone settings
+  bool changed = false;
+  bool bulkChanged = false;
+  ZoneCommand cmd;
+  while (zoneCommands.pop(cmd))
+  {
+    for (size_t i = 0; i < ZONE_COUNT; i++)
+    {
+      bool zoneChanged = false;
+      if ((cmd.setTempMask & (1u << i)) && (zones[i].setTemp != cmd.setTemp[i]))
+      {
+        LOG_INFOLN("%s Set Temp changed: %d ---> %d", zoneTable.name(i), zones[i].setTemp, cmd.setTemp[i]);
+        zones[i].setTemp = cmd.setTemp[i];
+        zoneChanged = true;
+      }
+      if ((cmd.enableMask & (1u << i)) && (zones[i].heatEnable != cmd.heatEnable[i]))
+      {
+        LOG_INFOLN("%s enable State Changed from %T ----> %T", zoneTable.name(i), zones[i].heatEnable, cmd.heatEnable[i]);
+        zones[i].heatEnable = cmd.heatEnable[i];
+        zoneChanged = true;
+      }
+      if (zoneChanged)
+      {
+        turnOffHeating(i);
+        changed = true;
+        bulkChanged |= cmd.bulk;
+      }
+    }
+  }
+
+  if (changed)
+  {
+    publishZoneState();
+#ifdef STATUS_PUBLISH_DELTA
+    // A bulk command gets one full status rather than a delta per zone
+    if (bulkChanged)
+      bulkStatusPending = true;
+#else
+    statusPublishPending = true;
+#endif
+    prefsStorePending = true;
+  }
+
+  LOG_VERBOSELN("Exiting...");
+}
+
+void onZonesSetMessage(const char *topic, char *msg, size_t len, intptr_t context)
+{
+  LogScope scope("onZonesSetMessage()");
+  LOG_VERBOSELN("Entering...");
+
+  // Parsed in place: keys point into msg, which outlives doc
+  StaticJsonDocument<bulkDocCapacity> doc;
+  uint8_t first = (uint8_t)msg[0];
+  bool msgPack = ((first & 0xF0) == 0x80) || (first == 0xDE) || (first == 0xDF); // Map headers
+  DeserializationError err = msgPack ? deserializeMsgPack(doc, msg, len) : deserializeJson(doc, msg, len);
+  if (err)
+  {
+    LOG_WARNINGLN("Bad zones command: %s", err.c_str());
+    return;
+  }
+
+  // Every zone goes into one command, so the control task applies them
+  // in the same pass and they are published and stored once
+  ZoneCommand cmd = {};
+  cmd.bulk = true;
+  for (JsonPair kv : doc.as<JsonObject>())
+  {
+    int i = zoneTable.indexOf(kv.key().c_str());
+    if (i < 0)
+      continue; // Another unit's zone
+
+    JsonVariant setTemp = kv.value()["SetTemp"];
+    if (setTemp.is<int>())
+    {
+      cmd.setTempMask |= 1u << i;
+      cmd.setTemp[i] = setTemp.as<int>();
+    }
+    JsonVariant enabled = kv.value()["Enabled"];
+    if (enabled.is<bool>())
+    {
+      cmd.enableMask |= 1u << i;
+      cmd.heatEnable[i] = enabled.as<bool>();
+    }
+  }
+
+  if (cmd.setTempMask | cmd.enableMask)
+    queueZoneCommand(cmd);
+
+  LOG_VERBOSELN("Exiting...");
+}
+
+void onSetPointMessage(const char *topic, char *msg, size_t len, intptr_t zone)
+{
+  LOG_VERBOSELN("Processing SetPoint command for Zone %s", zoneTable.name(zone));
+  ZoneCommand cmd = {};
+  cmd.setTempMask = 1u << zone;
+  cmd.setTemp[zone] = atoi(msg);
+  queueZoneCommand(cmd);
+}
+
+void onEnableMessage(const char *topic, char *msg, size_t len, intptr_t zone)
+{
+  LOG_VERBOSELN("Processing Heat Enable command for Zone %s", zoneTable.name(zone));
+  ZoneCommand cmd = {};
+  cmd.enableMask = 1u << zone;
+  cmd.heatEnable[zone] = atoi(msg) != 0;
+  queueZoneCommand(cmd);
+}
@@ -0,0 +1,212 @@
+#include <Arduino.h>
+#include <Logger.h>
+#include <LogScope.h>
+#include "Control.h"
+#if !defined(THERMISTOR_BETA_MODEL)
+#include <SensorChartTable.h> // Generated at build time by scripts/gen_sensor_table.py
+#endif
+
+// App Constants
+constexpr double Rref = 10000.0;
+constexpr double Beta = 3894; // 3950.0;
+constexpr double To = 298.15;
+constexpr double Ro = 10000.0;
+constexpr double adcMax = 4096;
+constexpr double Rshorted = 500.0;   // Anything below this is a shorted sensor
+constexpr double Ropen = 1000000.0;  // Anything above this is an open sensor
+
+// The formula ConvertValToTemp() used before the tables
+constexpr thermistor::BetaModel floorSensorModel = {Rref, Ro, To, Beta, adcMax, Rshorted, Ropen};
+
+#if defined(THERMISTOR_BETA_MODEL)
+// 1025 entries (4 KB of flash), interpolated every 4 codes
+static constexpr thermistor::TempTable<2> zoneTempTable(floorSensorModel);
+#else
+// Piecewise fit of the Honeywell resistance chart, same layout as above
+static_assert(thermistor::honeywell::Rref == Rref, "Regenerate the sensor table for this Rref");
+static constexpr const auto &zoneTempTable = thermistor::honeywell::table;
+#endif
+
+// Core System Parameters
+ZoneState zones[ZONE_COUNT];
+
+ZoneSampler<ZONE_COUNT, SAMPLE_DEPTH> zoneSampler;
+
+// Alarms raised on the control task, published later from the UI task
+std::atomic<const char *> zoneAlarm[ZONE_COUNT];
+
+void initZones()
+{
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    zones[i].actualTemp = 72.0;
+    zones[i].readVal = 2048;
+    zones[i].setTemp = 72;
+    zones[i].heatEnable = false;
+    zones[i].heating = false;
+    zones[i].mode = HeatingMode::Off;
+  }
+}
+
+#if !defined(ZONE_RELAY_DRIVER)
+void zoneRelayBegin()
+{
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+    pinMode(zoneTable.def[i].outPin, OUTPUT);
+}
+
+void zoneRelayWrite(size_t i, bool on)
+{
+  digitalWrite(zoneTable.def[i].outPin, on);
+}
+#endif
+
+void turnOffHeating(int i)
+{
+  zones[i].heating = false;
+  zones[i].mode = HeatingMode::Off;
+  zoneRelayWrite(i, false);
+}
+
+void raiseZoneAlarm(int zone, const char *message)
+{
+  // Called from the control task - never touches the network directly
+  zoneAlarm[zone].store(message, std::memory_order_release);
+}
+
+float ConvertValToTemp(int Vo)
+{
+  LogScope scope("ConvertValToTemp(int Vo)");
+  LOG_VERBOSELN("Entering...");
+
+  // Table is generated at build time (Honeywell chart, or the Beta equation
+  // with THERMISTOR_BETA_MODEL), so this is a lookup plus interpolation -
+  // no log() or double math at runtime.
+  float Tf = zoneTempTable.lookup(Vo);
+
+  LOG_VERBOSELN("Exiting...");
+  return Tf;
+}
+
+void selectMuxChannel(int8_t channel)
+{
+  for (size_t b = 0; b < muxSelectCount; b++)
+    digitalWrite(muxSelectPins[b], (channel >> b) & 1);
+  delayMicroseconds(MUX_SETTLE_US);
+}
+
+void sampleZones()
+{
+  // Runs on the sampler task every SAMPLE_PERIOD_MS - keep logging out of it.
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    const ZoneDef &def = zoneTable.def[i];
+    if (def.muxChannel >= 0)
+      selectMuxChannel(def.muxChannel);
+    zoneSampler.push(i, analogRead(def.inPin));
+  }
+}
+
+void GetTemps()
+{
+  LogScope scope("GetTemps()");
+  LOG_VERBOSELN("Entering...");
+
+  LOG_VERBOSELN("Reading Temps");
+
+  // Latest filtered values from the sampler - never waits on the ADC
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    zones[i].readVal = zoneSampler.filtered(i);
+    zones[i].actualTemp = ConvertValToTemp(zones[i].readVal);
+  }
+
+  LOG_VERBOSELN("Exiting...");
+}
+
+void SetHeatControl()
+{
+  LogScope scope("SetHeatControl()");
+  LOG_VERBOSELN("Entering...");
+
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    if (thermistor::isSensorFault(zones[i].actualTemp))
+    {
+      const char *warningMessage = (zones[i].actualTemp == thermistor::kSensorOpen) ? "SENSOR OPEN" : "SENSOR SHORTED";
+      LOG_VERBOSELN("!!! ERROR !!! %s", warningMessage);
+      raiseZoneAlarm(i, warningMessage);
+
+      LOG_VERBOSELN("!!! ERROR !!! %s - Shutting OFF %s", warningMessage, zoneTable.name(i));
+      zones[i].heating = false;
+      zones[i].mode = HeatingMode::Off;
+    }
+    else if (zones[i].actualTemp < 90)
+    {
+      LOG_VERBOSELN("Zone %s temp = %F  < 90F", zoneTable.name(i), zones[i].actualTemp);
+      // Are we allowed to heat?
+      if (zones[i].heatEnable)
+      { // Yes - Decide if we should heat.
+        LOG_VERBOSELN("Zone %s Heating Enabled", zoneTable.name(i));
+        // Cool enough to think about heating?
+        if ((zones[i].actualTemp <= (zones[i].setTemp + 0.5)))
+        { // Yes - Decide whether to turn on heat.
+          LOG_VERBOSELN("Zone %s temperature is below set point", zoneTable.name(i));
+          // Cool enough to turn on heat?
+          if (zones[i].actualTemp < (zones[i].setTemp - 0.5))
+          { // Yes - Heat it up!
+            LOG_VERBOSELN("%s HEATING", zoneTable.name(i));
+            zones[i].heating = true;
+            zones[i].mode = HeatingMode::Heating;
+          }
+          else
+          { // No - We're in the zone (+/- 0.5F). No change until upper or lower bound is reached.
+            // IDLE - if it is ON, leave it on i.e. still Heating
+            //        if it is OFF, leave it OFF i.e. cooling down from (zones[i].setTemp +1)
+            // zones[i].mode = HeatingMode::Idle;
+            LOG_VERBOSELN("Zone %s between +/- 0.5F of set point so no change.", zoneTable.name(i));
+          }
+        }
+        else
+        { // No - Hot enough, stop heating.
+          LOG_VERBOSELN("Zone %s temperature is above set point so turning off heating - IDLE", zoneTable.name(i));
+          zones[i].heating = false;
+          zones[i].mode = HeatingMode::Idle;
+        }
+      }
+      else // NOT zones[i].heatEnable
+      {
+        const char *warningMessage = "Unrequested Heating!!!";
+        if (zones[i].heating)
+        {
+          LOG_WARNINGLN("!!! ERROR !!! %s", warningMessage);
+          // Should also send MQTT message to alert someone
+          raiseZoneAlarm(i, warningMessage);
+        }
+        // LOG_WARNINGLN("!!! ERROR !!! %s - Shutting OFF %s", warningMessage, zoneTable.name(i));
+        zones[i].heating = false;
+        zones[i].mode = HeatingMode::Off;
+      }
+    }
+    else
+    {
+      const char *warningMessage = "OVERHEATING";
+      LOG_VERBOSELN("!!! ERROR !!! %s", warningMessage);
+      // Should also send MQTT message to alert someone
+      raiseZoneAlarm(i, warningMessage);
+
+      LOG_VERBOSELN("!!! ERROR !!! %s - Shutting OFF %s", warningMessage, zoneTable.name(i));
+      zones[i].heating = false;
+      zones[i].mode = HeatingMode::Off;
+    }
+
+    //****************************************
+    // The ONLY place that heating gets written
+    //
+    zoneRelayWrite(i, zones[i].heating);
+    //
+    // ***************************************
+  }
+
+  LOG_VERBOSELN("Exiting...");
+}
@@ -1,7 +1,8 @@
 #include <Arduino.h>
 #include <Logger.h>
-#define LOG_LEVEL Log.INFO
-#define DEBUG_MODE
+#include <LogScope.h>
+#include <ScopeTrace.h>
+#include <AsyncLogOutput.h>
 #include <Preferences.h>
 #include <WiFi.h>
 #include <time.h>
@@ -9,12 +10,30 @@
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
+#include <DirtySSD1306.h>
 #include <Fonts/FreeSans9pt7b.h>
 #include <ArduinoJson.h>
+#include <atomic>
+#include "Control.h"
+#include "Status.h"
+#include "Commands.h"
+#include "Settings.h"
+#include "Topics.h"
+#include <SpscQueue.h>
+#include <TopicRouter.h>
+#include <AllocCounter.h>
+#include <LittleFS.h>
+#include <HistoryStore.h>
+#include <ZoneAggregates.h>
+#include <Histogram.h>
+#ifdef FLOORTHERM_BENCH
+#include "CoreBench.h"
+#endif
 
 extern "C"
 {
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/timers.h"
 }
 
@@ -28,14 +47,73 @@ String hostname = "floortherm";
 #define SCREEN_WIDTH 128 /// OLED display width, in pixels
 #define SCREEN_HEIGHT 64 /// OLED display height, in pixels
 #define OLED_RESET -1    ///-1 => no reset on 4 pin SSD1315 OLED
+#define DISPLAY_I2C_HZ 400000 /// I2C fast mode while talking to the OLED
 
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+DirtySSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, DISPLAY_I2C_HZ, DISPLAY_I2C_HZ);
 /// define screen params
 
 #define I2C_SDA 21          /// ESP8266 NodeMCU SDA pin GPIO4 = D2
 #define I2C_SCL 22          /// ESP8266 NodeMCU SCL pin GPIO5 = D1
 #define SCREEN_ADDRESS 0x3C /// 0x3C for SSD1315 OLED
 
+// ********************* Sampling Parameters ************************
+// Sensor sampling and control rates are in Control.h
+#define UI_PERIOD_MS 500      /// Time between UI task passes (publishing, LED)
+#define DISPLAY_FPS 10        /// Display task frame rate
+#define DISPLAY_ARROW_MS 500  /// Heating arrow animation step
+#define DISPLAY_ZONE_ROWS 5   /// Zone rows that fit under the title
+#define DISPLAY_PAGE_MS 4000  /// Time each page is shown when zones don't fit
+#define DISPLAY_ROW_TOP 15    /// First zone row, under the title
+#define DISPLAY_ROW_PITCH 10  /// Pixels between zone rows
+#define DISPLAY_VALUE_X 36    /// Zone name column ends, temperature and status start
+
+// ********************* Task Parameters ************************
+// Control (sampling, hysteresis, relays) owns core 1; display, publishing
+// and logging run on core 0 next to WiFi so they can never delay a relay.
+#define CONTROL_CORE 1
+#define UI_CORE 0
+#define SAMPLER_PRIORITY 6
+#define CONTROL_PRIORITY 5
+#define UI_PRIORITY 1
+#define DISPLAY_PRIORITY 2
+#define LOG_DRAIN_PRIORITY 0 /// Serial log drain only runs when the core is otherwise idle
+#define TASK_LOAD_WINDOW_US 10000000 /// CPU utilisation averaging window
+#define CONTROL_HIST_BINS 15         /// Control tick histogram bins, 16 us up to 128 ms and over
+#define CONTROL_HIST_MIN_BITS 4      /// First histogram bin holds anything under 16 us
+#define STAGE_HIST_BINS 18           /// Stage run time histogram bins, 4 us up to 256 ms and over
+#define STAGE_HIST_MIN_BITS 2        /// First stage bin holds anything under 4 us
+#define METRICS_PERIOD_MS 60000      /// Time between metrics publishes, and the stage timing window
+
+// ********************* History Parameters ************************
+#define HISTORY_PERIOD_S 60          /// Time between history samples
+#define HISTORY_MIN_EPOCH 1672531200 /// 2023-01-01, an earlier clock means NTP hasn't synced yet
+#define HISTORY_RAM_BLOCKS 8         /// Newest compressed blocks kept in RAM (4 KB)
+#define HISTORY_SEGMENT_BLOCKS 64    /// Blocks per flash segment file (32 KB)
+#define HISTORY_SEGMENTS 8           /// Segment files kept, 256 KB of flash in all
+#define HISTORY_QUERY_BLOCKS 2       /// Blocks sent per UI pass while answering a query
+
+// ********************* Aggregate Parameters ************************
+#define AGGREGATE_BASE_S 60        /// Finest aggregate period, built on the control task
+#define AGGREGATE_MID_S 900        /// Quarter hour aggregates
+#define AGGREGATE_COARSE_S 3600    /// Hourly aggregates
+#define AGGREGATE_BASE_DEPTH 60    /// Minutes kept (1 hour)
+#define AGGREGATE_MID_DEPTH 96     /// Quarter hours kept (1 day)
+#define AGGREGATE_COARSE_DEPTH 72  /// Hours kept (3 days)
+#define AGGREGATE_QUERY_BUCKETS 4  /// Buckets sent per UI pass while answering a summary request
+#define SUMMARY_JSON_MAX (ZONE_COUNT * 64 + 96) /// Zone name and four values per zone plus the header
+
+// ********************* Trace Parameters ************************
+#define TRACE_LINES_PER_PASS 24 /// Trace lines sent per UI pass while dumping
+#define TRACE_LINE_MAX 96       /// Longest trace line, longer scope names are cut
+#define TRACE_MSG_MAX 1536      /// Trace reply message size
+#define TRACE_SEND_TRIES 20     /// Failed sends in a row before a dump is dropped (10 s of UI passes)
+
+// ********************* Benchmark Parameters ************************
+// Only used with FLOORTHERM_BENCH, see runBenchmarks()
+#define BENCH_MQTT_OPS 2000  /// onMqttMessage() dispatches of the mixed stream
+#define BENCH_RENDER_OPS 500 /// Framebuffer renders of every zone row
+#define BENCH_FRAME_OPS 50   /// Full frames sent over I2C
+
 // ********************* WiFi Parameters ************************
 #define WIFI_SSID "vtap"
 #define WIFI_PASSWORD "things1250"
@@ -55,76 +133,199 @@ AsyncMqttClient mqttClient;
 TimerHandle_t mqttReconnectTimer;
 TimerHandle_t mqttRegisterIDTimer;
 
-// Published Topics
-const char *mainPubTopic = "floortherm/"; // Topic to publish
-const char *aliveTopic = "floortherm/online";
-const char *alarmTopic = "floortherm/alarm";
-const char *willTopic = "floortherm/offline";
-const char *statusTopic = "floortherm/status";
-
-// Subscribed Topics
-const char *SubTopic = "floortherm/#";
-const char *setTempTopic = "floortherm/#/set";
-const char *enableHeatTopic = "floortherm/#/enable";
-const char *getStatusTopic = "floortherm/get";
-const char *logLevelTopic = "floortherm/sys/log/";
-const char *restartTopic = "floortherm/sys/restart";
+TopicRouter<TOPIC_ROUTES> topicRouter;
 
 
 // ********************* App Parameters ************************
-Preferences preferences;
-
-int floorthermIndex = -1;
-
-// App Constants
-float Rref = 10000.0;
-float Beta = 3894; // 3950.0;
-float To = 298.15;
-float Ro = 10000.0;
-float adcMax = 4096;
-float Vs = 3.3;
-
-// Core System Parameters
-int zoneSetTemp[] = {72, 72, 72, 72, 72};
-bool zoneHeatEnable[] = {false, false, false, false, false};
-
-// Zone Data
-#if defined(DEBUG_MODE)
-const char *zoneFriendlyNames[] = {"Zone A", "Zone B", "Zone C", "Zone D", "Zone E"};
-const char *zoneNames[] = {"ZNA", "ZNB", "ZNC", "ZND", "ZNE"};
-#else
-const char *zoneFriendlyNames[] = {"Master Bedroom", "Narayan's Room", "Office", "Shanti's Room", "Maya's Room"};
-const char *zoneNames[] = {"MBR", "NAV", "OFC", "SMV", "MAV"};
-#endif
-
-int inPins[] = {32, 33, 34, 35, 36};
-int outPins[] = {16, 17, 18, 19, 23};
+std::atomic<bool> metricsPublishPending(false);
 
-float zoneActualTemp[] = {72.0, 72.0, 72.0, 72.0, 72.0};
-int zoneReadVal[] = {2048, 2048, 2048, 2048, 2048};
+// Zone history, recorded and queried on the UI task only
+struct HistoryQuery
+{
+  uint32_t from;
+  uint32_t to;
+};
+
+// Each reply message is a HistoryChunk header followed by one block, cut
+// to the bytes it uses. The final message is a header with
+// HISTORY_CHUNK_LAST set and no block.
+struct HistoryChunk
+{
+  uint16_t seq;
+  uint16_t flags;
+};
+#define HISTORY_CHUNK_LAST 0x0001
+
+HistorySegments historySegments(LittleFS, "/history", HISTORY_SEGMENT_BLOCKS, HISTORY_SEGMENTS);
+HistoryStore<ZONE_COUNT, HISTORY_RAM_BLOCKS> history(&historySegments);
+SpscQueue<HistoryQuery, 4> historyQueries; // Producer: MQTT callback, consumer: UI task
+uint32_t historyLastSlot = 0;
+uint8_t historyChunk[sizeof(HistoryChunk) + HISTORY_BLOCK_BYTES];
+size_t historyChunkLen = 0; /// Built but not yet accepted by the MQTT client
+uint16_t historyChunkSeq = 0;
+uint32_t historyAppendUs = 0;
+
+// Per-zone min/max/mean/duty. The control task builds the minute buckets,
+// the UI task rolls them up and answers summary requests.
+struct SummaryRequest
+{
+  uint16_t periodMin;
+  uint16_t count; /// Newest buckets wanted, 0 for all
+};
 
-bool zoneHeating[] = {false, false, false, false, false};
-String zoneHeatingMode[] = {"OFF", "OFF", "OFF", "OFF", "OFF"};
-int zoneHeatArrowCounter[] = {0, 0, 0, 0, 0};
+// Summary reply being sent (UI task only)
+struct SummaryReply
+{
+  bool active;
+  uint32_t periodS;
+  uint32_t next; /// Serial of the next bucket to send
+  uint32_t end;  /// Serial after the newest bucket when the request arrived
+  uint16_t seq;
+};
+
+AggregateSampler<ZONE_COUNT> aggregateSampler(AGGREGATE_BASE_S); // Control task only
+SpscQueue<AggregateBucket<ZONE_COUNT>, 4> aggregateBuckets;       // Producer: control task, consumer: UI task
+std::atomic<uint32_t> aggregateDropped(0);
+AggregateLevel<ZONE_COUNT, AGGREGATE_BASE_DEPTH> aggregateMinutes(AGGREGATE_BASE_S);
+AggregateLevel<ZONE_COUNT, AGGREGATE_MID_DEPTH> aggregateQuarters(AGGREGATE_MID_S);
+AggregateLevel<ZONE_COUNT, AGGREGATE_COARSE_DEPTH> aggregateHours(AGGREGATE_COARSE_S);
+SpscQueue<SummaryRequest, 4> summaryRequests; // Producer: MQTT callback, consumer: UI task
+SummaryReply summaryReply = {false, 0, 0, 0, 0};
+
+// Scope trace dump. The MQTT callback asks for one, the UI task sends it
+// a few lines per pass with recording paused.
+enum TraceTarget : uint8_t
+{
+  TRACE_NONE,
+  TRACE_MQTT,
+  TRACE_SERIAL
+};
 
-char setPointTopics[5][50];
-char enableTopics[5][50];
+struct TraceDump
+{
+  TraceTarget target;
+  uint32_t next; /// Serial of the next event to send
+  uint32_t end;
+  uint8_t failures; /// Sends failed in a row
+  char header[192]; /// Sent ahead of the first event, then cleared
+};
+std::atomic<uint8_t> traceRequest(TRACE_NONE);
+TraceDump traceDump = {TRACE_NONE, 0, 0, 0, ""};
+const char traceEndLine[] = "#T end\n";
+
+struct TaskLoad
+{
+  const char *name;
+  int core;
+  TaskHandle_t handle;
+  uint32_t busyUs;        /// Busy time in the current window
+  uint32_t windowStartUs; /// Start of the current window
+  float cpuPercent;       /// Utilisation over the last completed window
+  uint32_t passes;        /// Loop passes in the current window
+  uint32_t windowAllocs;  /// Task's allocation count at the start of the window
+  float allocsPerPass;    /// Heap allocations per pass over the last window
+};
+
+// Control tick timing - control task writes, publishControlMetrics() reads and resets
+typedef Histogram<CONTROL_HIST_BINS, CONTROL_HIST_MIN_BITS> ControlHistogram;
+struct ControlStats
+{
+  ControlHistogram jitterUs; /// Wake time minus the scheduled tick
+  ControlHistogram execUs;   /// Time from wake to the end of the pass
+  std::atomic<uint32_t> overruns;
+};
+ControlStats controlStats;
+
+// Run time of the main loop stages. Each stage runs on one task only, which
+// writes its histogram; publishTaskMetrics() reads and resets them all.
+typedef Histogram<STAGE_HIST_BINS, STAGE_HIST_MIN_BITS> StageHistogram;
+enum Stage : uint8_t
+{
+  STAGE_GET_TEMPS,
+  STAGE_SET_HEAT,
+  STAGE_DISPLAY,
+  STAGE_PUBLISH_STATUS,
+  STAGE_HISTORY,
+  STAGE_COUNT
+};
+const char *const stageNames[STAGE_COUNT] = {"GetTemps", "SetHeatControl", "Display", "PublishStatus", "History"};
+StageHistogram stageUs[STAGE_COUNT];
+uint32_t stageWindowStart = 0; /// millis() at the last metrics publish
+
+// Times a stage from construction to the end of the enclosing scope
+struct StageTimer
+{
+  explicit StageTimer(Stage stage) : stage(stage), start(micros()) {}
+  ~StageTimer() { stageUs[stage].add(micros() - start); }
+  Stage stage;
+  uint32_t start;
+};
+
+TaskLoad samplerLoad = {"sampler", CONTROL_CORE, NULL, 0, 0, 0, 0, 0, 0};
+TaskLoad controlLoad = {"control", CONTROL_CORE, NULL, 0, 0, 0, 0, 0, 0};
+TaskLoad uiLoad = {"ui", UI_CORE, NULL, 0, 0, 0, 0, 0, 0};
+TaskLoad displayLoad = {"display", UI_CORE, NULL, 0, 0, 0, 0, 0, 0};
+TaskLoad *taskLoads[] = {&samplerLoad, &controlLoad, &uiLoad, &displayLoad};
 
 unsigned long lastStatusBroadcast = 0;
+unsigned long lastLogBroadcast = 0;
 
 bool ledOn = true;
 
 const char delim[2] = "/";
 
-const int docCapacity = JSON_OBJECT_SIZE(5) + 5 * JSON_OBJECT_SIZE(4);
-const int roomDocCapacity = JSON_OBJECT_SIZE(4);
+// Last zone state sent on each zone status topic (UI task only)
+ZoneState zoneStatusSent[ZONE_COUNT];
+bool zoneStatusValid[ZONE_COUNT];
+std::atomic<bool> zoneStatusResync(true);
 int logDisplayCounter = 0;
 int maxOtherIndex = 0;
 bool indexWaitDone = false;
 
+// What each zone row on the OLED currently shows (UI task only)
+struct DisplayRow
+{
+  int16_t zone; /// -1 for a blank row
+  int16_t temp;
+  int16_t setTemp;
+  HeatingMode mode;
+  uint8_t arrow;
+};
+DisplayRow displayRows[DISPLAY_ZONE_ROWS];
+bool displayFullRedraw = true;
+bool displayFound = false;
+
+// Inputs of the rows on screen. A frame is skipped when none moved on, or
+// when they did but the rows built from them come out the same.
+uint32_t displayVersion = 0;
+size_t displayPage = 0;
+uint32_t displayArrowTick = 0;
+bool displayAnimating = false;
+bool displayIsBlank = false;
+std::atomic<bool> displayBlanked(false);
+
+// Display task writes, publishTaskMetrics() reads and resets
+struct DisplayStats
+{
+  std::atomic<uint32_t> frames;
+  std::atomic<uint32_t> skipped;
+  std::atomic<uint32_t> i2cBytes;
+  std::atomic<uint32_t> renderUs;
+};
+DisplayStats displayStats;
+
 // ********************* Debug and Logging Parameters ************************
-String methodName = "FloorTherm";
-int logLevel = LOG_LEVEL;
+#define LOG_MQTT_FLUSH_BYTES 768   /// Publish a log batch once it holds this much
+#define LOG_MQTT_FLUSH_MS 5000     /// ...or once its oldest line is this old
+#define LOG_MQTT_BYTES_PER_SEC 256 /// Average log bandwidth allowed on MQTT
+
+bool publishLogBatch(const char *data, size_t len);
+
+AsyncLogOutput asyncLog; /// Log lines queue here and reach Serial from a drain task
+LogBatch mqttLog(publishLogBatch, LOG_MQTT_FLUSH_BYTES, LOG_MQTT_FLUSH_MS, LOG_MQTT_BYTES_PER_SEC);
+#ifndef LOG_BINARY
+#define LOG_BINARY false /// Start with binary log records, read them with scripts/log_decode.py
+#endif
 
 const char *logLevelNames[] = {
     "silent",
@@ -167,237 +368,462 @@ void printTimestamp(Print *_logOutput, int x)
   }
   _logOutput->print(c);
   _logOutput->print(": ");
-  _logOutput->print(methodName);
+  const char *scope = LogScope::current();
+  _logOutput->print(scope ? scope : "FloorTherm");
   _logOutput->print(": ");
 }
 
-void storePrefs()
+bool publishLogBatch(const char *data, size_t len)
 {
-  String oldMethodName = methodName;
-  methodName = "storePrefs()";
-  Log.verboseln("Entering...");
+  // Runs on the log drain task - logging from here would feed back into itself
+  if (!mqttClient.connected() || (floorthermIndex < 0))
+    return false;
 
-  Log.infoln("Storing Preferences.");
-  preferences.putInt("Z0SetTemp", zoneSetTemp[0]);
-  preferences.putInt("Z1SetTemp", zoneSetTemp[1]);
-  preferences.putInt("Z2SetTemp", zoneSetTemp[2]);
-  preferences.putInt("Z3SetTemp", zoneSetTemp[3]);
-  preferences.putInt("Z4SetTemp", zoneSetTemp[4]);
+  char topic[24];
+  snprintf(topic, sizeof(topic), "%s%d", logPubTopic, floorthermIndex);
+  return mqttClient.publish(topic, 0, false, data, len) != 0;
+}
 
-  preferences.putBool("Z0Enabled", zoneHeatEnable[0]);
-  preferences.putBool("Z1Enabled", zoneHeatEnable[1]);
-  preferences.putBool("Z2Enabled", zoneHeatEnable[2]);
-  preferences.putBool("Z3Enabled", zoneHeatEnable[3]);
-  preferences.putBool("Z4Enabled", zoneHeatEnable[4]);
+void recordHistory(uint32_t now)
+{
+  HistorySample<ZONE_COUNT> s;
+  ZoneSnapshot zs = zoneState.read();
 
-  preferences.putInt("LogLevel", logLevel);
+  s.time = now;
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    s.temp[i] = lroundf(zs.zone[i].actualTemp * 10);
+    s.setTemp[i] = zs.zone[i].setTemp;
+    s.heating[i] = zs.zone[i].heating;
+  }
 
-  if (floorthermIndex > -1)
-    preferences.putInt("FloorthermIndex", floorthermIndex);
+  uint32_t start = micros();
+  history.record(s);
+  historyAppendUs = micros() - start;
+}
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+/**
+ * Fills historyChunk with the next reply message of the running query.
+ * \return false if there is nothing left to send
+ */
+bool nextHistoryChunk()
+{
+  if (!history.queryActive())
+    return false;
+
+  HistoryChunk chunk = {historyChunkSeq++, 0};
+  uint8_t *block = historyChunk + sizeof(chunk);
+  historyChunkLen = sizeof(chunk);
+  if (history.nextBlock(block))
+  {
+    HistoryBlockHeader h;
+    memcpy(&h, block, sizeof(h));
+    historyChunkLen += sizeof(h) + h.used;
+  }
+  else
+    chunk.flags |= HISTORY_CHUNK_LAST;
+  memcpy(historyChunk, &chunk, sizeof(chunk));
+  return true;
 }
 
-void loadPrefs()
+/**
+ * Records a sample every HISTORY_PERIOD_S once the clock is set, and sends
+ * a few blocks of any running history query. UI task only.
+ */
+void serviceHistory()
 {
-  String oldMethodName = methodName;
-  methodName = "loadPrefs()";
-  Log.verboseln("Entering...");
+  StageTimer timer(STAGE_HISTORY);
+  time_t now = time(NULL);
+  if ((now > HISTORY_MIN_EPOCH) && (now / HISTORY_PERIOD_S != historyLastSlot))
+  {
+    historyLastSlot = now / HISTORY_PERIOD_S;
+    recordHistory(now);
+  }
+  history.flush();
 
-  Log.infoln("Loading Preferences.");
+  if ((historyChunkLen == 0) && !history.queryActive())
+  {
+    HistoryQuery q;
+    if (!historyQueries.pop(q))
+      return;
+    LOG_INFOLN("Sending history from %u to %u", q.from, q.to);
+    history.beginQuery(q.from, q.to);
+    historyChunkSeq = 0;
+  }
 
-  bool doesExist = preferences.isKey("Z0SetTemp");
+  if (!mqttClient.connected())
+    return;
 
-  if (doesExist)
+  char topic[24];
+  snprintf(topic, sizeof(topic), "%s%d", historyPubTopic, floorthermIndex);
+  for (int n = 0; n < HISTORY_QUERY_BLOCKS; n++)
   {
-    Log.infoln("Loading zone settings.");
-    zoneSetTemp[0] = preferences.getInt("Z0SetTemp");
-    zoneSetTemp[1] = preferences.getInt("Z1SetTemp");
-    zoneSetTemp[2] = preferences.getInt("Z2SetTemp");
-    zoneSetTemp[3] = preferences.getInt("Z3SetTemp");
-    zoneSetTemp[4] = preferences.getInt("Z4SetTemp");
-
-    zoneHeatEnable[0] = preferences.getBool("Z0Enabled");
-    zoneHeatEnable[1] = preferences.getBool("Z1Enabled");
-    zoneHeatEnable[2] = preferences.getBool("Z2Enabled");
-    zoneHeatEnable[3] = preferences.getBool("Z3Enabled");
-    zoneHeatEnable[4] = preferences.getBool("Z4Enabled");
-
-    logLevel = preferences.getInt("LogLevel");
+    if ((historyChunkLen == 0) && !nextHistoryChunk())
+      break;
+    // Kept for the next pass if the client's buffer is full
+    if (mqttClient.publish(topic, 1, false, (const char *)historyChunk, historyChunkLen) == 0)
+      break;
+    historyChunkLen = 0;
   }
-  else
+
+  if ((historyChunkLen == 0) && !history.queryActive() && (historyChunkSeq > 0))
   {
-    Log.warningln("Could not find Preferences!");
-    storePrefs();
+    LOG_INFOLN("History sent in %d messages", (int)historyChunkSeq);
+    historyChunkSeq = 0;
   }
+}
 
-  bool doesIndexExist = preferences.isKey("FloorthermIndex");
-  if (doesIndexExist)
+void aggregateZones()
+{
+  // Control task, every pass - O(1) per zone and no logging
+  AggregateBucket<ZONE_COUNT> done;
+  if (aggregateSampler.roll(time(NULL), done) && !aggregateBuckets.push(done))
+    aggregateDropped++;
+
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+    aggregateSampler.add(i, zones[i].actualTemp, !thermistor::isSensorFault(zones[i].actualTemp), zones[i].heating);
+}
+
+void addSummaryValue(JsonObject &zone, const char *key, int16_t tenths)
+{
+  if (tenths == INT16_MIN)
+    zone[key] = nullptr;
+  else
+    zone[key] = tenths / 10.0;
+}
+
+/**
+ * Publishes the next few buckets of the running summary reply.
+ */
+template <typename Level>
+void sendSummary(const Level &level, const char *topic)
+{
+  StaticJsonDocument<JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(ZONE_COUNT) + ZONE_COUNT * JSON_OBJECT_SIZE(4)> doc;
+  char payload[SUMMARY_JSON_MAX];
+
+  for (int n = 0; n < AGGREGATE_QUERY_BUCKETS && summaryReply.active; n++)
   {
-    Log.infoln("Loading index.");
-    floorthermIndex = preferences.getInt("FloorthermIndex");
+    // Buckets overwritten while the reply was going out are skipped
+    if (summaryReply.next < level.oldest())
+      summaryReply.next = level.oldest();
+    bool empty = summaryReply.next >= summaryReply.end;
+    uint32_t remaining = empty ? 0 : summaryReply.end - summaryReply.next - 1;
+
+    doc.clear();
+    doc["Period"] = level.periodS();
+    doc["Seq"] = summaryReply.seq;
+    doc["Remaining"] = remaining;
+    if (!empty)
+    {
+      uint32_t serial = summaryReply.next;
+      doc["Start"] = level.start(serial);
+      JsonObject zonesJson = doc.createNestedObject("Zones");
+      for (size_t i = 0; i < ZONE_COUNT; i++)
+      {
+        const AggregateSummary &s = level.summary(serial, i);
+        JsonObject zone = zonesJson.createNestedObject(zoneTable.name(i));
+        addSummaryValue(zone, "Min", s.min);
+        addSummaryValue(zone, "Max", s.max);
+        addSummaryValue(zone, "Mean", s.mean);
+        zone["Duty"] = s.duty;
+      }
+    }
+
+    size_t len = serializeJson(doc, payload, sizeof(payload));
+    // Retried on the next pass if the client's buffer is full
+    if (mqttClient.publish(topic, 0, false, payload, len) == 0)
+      break;
+
+    summaryReply.seq++;
+    summaryReply.next++;
+    if (remaining == 0)
+    {
+      LOG_INFOLN("Summary sent in %d messages", (int)summaryReply.seq);
+      summaryReply.active = false;
+    }
   }
+}
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+template <typename Level>
+void beginSummary(const Level &level, uint16_t count)
+{
+  summaryReply.active = true;
+  summaryReply.periodS = level.periodS();
+  summaryReply.end = level.written();
+  summaryReply.next = level.oldest();
+  if ((count > 0) && (summaryReply.end - summaryReply.next > count))
+    summaryReply.next = summaryReply.end - count;
+  summaryReply.seq = 0;
 }
 
-void buildCommandTopics()
+/**
+ * Rolls the control task's minute buckets up into the coarser levels and
+ * answers summary requests. UI task only.
+ */
+void serviceAggregates()
 {
-  String oldMethodName = methodName;
-  methodName = "buildCommandTopics()";
-  Log.verboseln("Entering...");
+  AggregateBucket<ZONE_COUNT> b;
+  while (aggregateBuckets.pop(b))
+  {
+    aggregateMinutes.add(b, AGGREGATE_BASE_S);
+    aggregateQuarters.add(b, AGGREGATE_BASE_S);
+    aggregateHours.add(b, AGGREGATE_BASE_S);
+  }
+
+  uint32_t dropped = aggregateDropped.exchange(0);
+  if (dropped > 0)
+    LOG_WARNINGLN("Aggregate queue full, lost %d minutes", (int)dropped);
+
+  SummaryRequest req;
+  if (!summaryReply.active && summaryRequests.pop(req))
+  {
+    LOG_INFOLN("Sending %d minute summary", (int)req.periodMin);
+    if (req.periodMin * 60 == AGGREGATE_BASE_S)
+      beginSummary(aggregateMinutes, req.count);
+    else if (req.periodMin * 60 == AGGREGATE_MID_S)
+      beginSummary(aggregateQuarters, req.count);
+    else if (req.periodMin * 60 == AGGREGATE_COARSE_S)
+      beginSummary(aggregateHours, req.count);
+    else
+      LOG_WARNINGLN("No %d minute summary, use %d, %d or %d", (int)req.periodMin,
+                    AGGREGATE_BASE_S / 60, AGGREGATE_MID_S / 60, AGGREGATE_COARSE_S / 60);
+  }
+
+  if (!summaryReply.active || !mqttClient.connected())
+    return;
 
-  String tT[5];
-  String eT[5];
+  char topic[24];
+  snprintf(topic, sizeof(topic), "%s%d", summaryPubTopic, floorthermIndex);
+  if (summaryReply.periodS == AGGREGATE_BASE_S)
+    sendSummary(aggregateMinutes, topic);
+  else if (summaryReply.periodS == AGGREGATE_MID_S)
+    sendSummary(aggregateQuarters, topic);
+  else
+    sendSummary(aggregateHours, topic);
+}
 
-  Log.infoln("Building strings...");
-  for (int i = 0; i < 5; i++)
+bool sendTraceText(const char *text, size_t len)
+{
+  // Serial writes each buffer under the UART lock, so log lines from
+  // other tasks can't land in the middle
+  if (traceDump.target == TRACE_SERIAL)
+    return Serial.write((const uint8_t *)text, len) == len;
+
+  char topic[24];
+  snprintf(topic, sizeof(topic), "%s%d", tracePubTopic, floorthermIndex);
+  return mqttClient.publish(topic, 0, false, text, len) != 0;
+}
+
+void beginTrace(TraceTarget target)
+{
+  LogScope scope("beginTrace()");
+  LOG_VERBOSELN("Entering...");
+
+  // Hold the ring still until the dump is done, and read both cores'
+  // cycle counters against one clock so their events line up
+  scopeTracePause(true);
+  traceDump.target = target;
+  traceDump.next = scopeTraceOldest();
+  traceDump.end = scopeTraceWritten();
+  traceDump.failures = 0;
+
+  size_t len = snprintf(traceDump.header, sizeof(traceDump.header), "#T trace %lu %lu %lu\n",
+                        (unsigned long)traceDump.next, (unsigned long)traceDump.end, (unsigned long)scopeTraceCpuMHz());
+  for (uint8_t core = 0; core < portNUM_PROCESSORS; core++)
   {
-    String zn = zoneNames[i];
+    uint32_t cycles;
+    int64_t us;
+    if (scopeTraceClock(core, cycles, us) && (len < sizeof(traceDump.header)))
+      len += snprintf(traceDump.header + len, sizeof(traceDump.header) - len, "#T clock %u %lu %lld\n", core,
+                      (unsigned long)cycles, (long long)us);
+  }
+  LOG_INFOLN("Dumping %d trace events to %s", (int)(traceDump.end - traceDump.next),
+             target == TRACE_SERIAL ? "serial" : "MQTT");
 
-    tT[i] = "floortherm/" + zn + "/set";
-    strcpy(setPointTopics[i], tT[i].c_str());
+  LOG_VERBOSELN("Exiting...");
+}
+
+void endTrace()
+{
+  traceDump.target = TRACE_NONE;
+  scopeTracePause(false);
+}
 
-    eT[i] = "floortherm/" + zn + "/enable";
-    strcpy(enableTopics[i], eT[i].c_str());
+void serviceTrace()
+{
+  uint8_t request = traceRequest.exchange(TRACE_NONE);
+  if ((request != TRACE_NONE) && (traceDump.target == TRACE_NONE))
+    beginTrace((TraceTarget)request);
+  if (traceDump.target == TRACE_NONE)
+    return;
+
+  char msg[TRACE_MSG_MAX];
+  size_t len = strlcpy(msg, traceDump.header, sizeof(msg));
+  uint32_t next = traceDump.next;
+  // Every pass leaves room for the end line, in case it drains the dump
+  const size_t room = sizeof(msg) - (sizeof(traceEndLine) - 1);
+  for (int n = 0; (n < TRACE_LINES_PER_PASS) && (next < traceDump.end) && (len + TRACE_LINE_MAX <= room); n++)
+  {
+    ScopeTraceEvent e;
+    if (scopeTraceRead(next, e))
+      len += scopeTraceFormat(next, e, msg + len, TRACE_LINE_MAX);
+    next++;
+  }
+
+  bool last = next == traceDump.end;
+  if (last)
+  {
+    memcpy(msg + len, traceEndLine, sizeof(traceEndLine) - 1);
+    len += sizeof(traceEndLine) - 1;
   }
 
-  for (int i = 0; i < 5; i++)
+  // Try the same lines again next pass if the MQTT client is backed up,
+  // but don't leave recording paused for as long as the broker is away
+  if (!sendTraceText(msg, len))
   {
-    Log.verboseln("%d %s", i, enableTopics[i]);
-    Log.verboseln("%d %s", i, setPointTopics[i]);
+    if (++traceDump.failures >= TRACE_SEND_TRIES)
+    {
+      LOG_WARNINGLN("Trace dump dropped after %d failed sends", (int)traceDump.failures);
+      endTrace();
+    }
+    return;
   }
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+  traceDump.failures = 0;
+  traceDump.next = next;
+  traceDump.header[0] = 0;
+  if (last)
+    endTrace();
+}
+
+void setupHistory()
+{
+  LogScope scope("setupHistory()");
+  LOG_VERBOSELN("Entering...");
+
+  if (!LittleFS.begin(true))
+    LOG_ERRORLN("Could not mount flash file system, keeping history in RAM only");
+  else if (!historySegments.begin())
+    LOG_ERRORLN("Could not open history directory, keeping history in RAM only");
+  else
+    LOG_INFOLN("History holds %u bytes of flash", historySegments.bytesUsed());
+
+  LOG_VERBOSELN("Exiting...");
 }
 
 void publishIndex()
 {
-  String oldMethodName = methodName;
-  methodName = "publishIndex()";
-  Log.verboseln("Entering...");
+  LogScope scope("publishIndex()");
+  LOG_VERBOSELN("Entering...");
 
   char idx[10];
   sprintf(idx, "%d", floorthermIndex);
-  Log.infoln("Publishing FloorTherm Index %s at QoS 0", idx);
+  LOG_INFOLN("Publishing FloorTherm Index %s at QoS 0", idx);
 
   mqttClient.publish(aliveTopic, 1, true, idx);
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+  LOG_VERBOSELN("Exiting...");
 }
 
 void setIndex()
 {
-  String oldMethodName = methodName;
-  methodName = "setIndex()";
-  Log.verboseln("Entering...");
+  LogScope scope("setIndex()");
+  LOG_VERBOSELN("Entering...");
 
-  Log.infoln("Finished waiting for other floortherm index messages.");
-  Log.infoln("Highest received other index is %d", maxOtherIndex);
+  LOG_INFOLN("Finished waiting for other floortherm index messages.");
+  LOG_INFOLN("Highest received other index is %d", maxOtherIndex);
   indexWaitDone = true;
   if (floorthermIndex == -1)
   {
     floorthermIndex = maxOtherIndex + 1;
-    storePrefs();
+    prefsStorePending = true;
   }
 
   publishIndex();
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+  LOG_VERBOSELN("Exiting...");
 }
 
 void connectToWifi()
 {
-  String oldMethodName = methodName;
-  String methodName = "connectToWifi()";
+  LogScope scope("connectToWifi()");
 
-  Log.infoln("Connecting to Wi-Fi...");
+  LOG_INFOLN("Connecting to Wi-Fi...");
   WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE, INADDR_NONE);
   WiFi.setHostname(hostname.c_str());
   WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-
-  methodName = oldMethodName;
 }
 
 void connectToMqtt()
 {
-  String oldMethodName = methodName;
-  String methodName = "connectToMqtt()";
+  LogScope scope("connectToMqtt()");
 
-  Log.infoln("Connecting to MQTT...");
+  LOG_INFOLN("Connecting to MQTT...");
   mqttClient.connect();
-
-  methodName = oldMethodName;
 }
 
 void WiFiEvent(WiFiEvent_t event)
 {
-  String oldMethodName = methodName;
-  methodName = "WiFiEvent(WiFiEvent_t event)";
-  Log.verboseln("Entering...");
+  LogScope scope("WiFiEvent(WiFiEvent_t event)");
+  LOG_VERBOSELN("Entering...");
 
   switch (event)
   {
 #if USING_CORE_ESP32_CORE_V200_PLUS
 
   case ARDUINO_EVENT_WIFI_READY:
-    Log.infoln("WiFi ready");
+    LOG_INFOLN("WiFi ready");
     break;
 
   case ARDUINO_EVENT_WIFI_STA_START:
-    Log.infoln("WiFi STA starting");
+    LOG_INFOLN("WiFi STA starting");
     break;
 
   case ARDUINO_EVENT_WIFI_STA_CONNECTED:
-    Log.infoln("WiFi STA connected");
+    LOG_INFOLN("WiFi STA connected");
     break;
 
   case ARDUINO_EVENT_WIFI_STA_GOT_IP6:
   case ARDUINO_EVENT_WIFI_STA_GOT_IP:
-    Log.infoln("Connected to Wi-Fi. IP address: %p", WiFi.localIP());
-    Log.infoln("Connecting to NTP Server...");
+    LOG_INFOLN("Connected to Wi-Fi. IP address: %p", WiFi.localIP());
+    LOG_INFOLN("Connecting to NTP Server...");
     configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
-    Log.infoln("Connected to NTP Server!");
+    LOG_INFOLN("Connected to NTP Server!");
     time_t rawtime;
     struct tm *timeinfo;
     time(&rawtime);
     timeinfo = localtime(&rawtime);
     char tim[20];
     strftime(tim, 20, "%d/%m/%Y %H:%M:%S", timeinfo);
-    Log.infoln("Local Time: %s", tim);
+    LOG_INFOLN("Local Time: %s", tim);
 
-    Log.infoln("Connecting to MQTT Broker...");
+    LOG_INFOLN("Connecting to MQTT Broker...");
     connectToMqtt();
     break;
 
   case ARDUINO_EVENT_WIFI_STA_LOST_IP:
-    Log.infoln("WiFi lost IP");
+    LOG_INFOLN("WiFi lost IP");
     break;
 
   case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
-    Log.infoln("Disconnected from Wi-Fi. (Lost connection to WiFi)");
-    Log.infoln("Stop mqttReconnectTimer");
+    LOG_INFOLN("Disconnected from Wi-Fi. (Lost connection to WiFi)");
+    LOG_INFOLN("Stop mqttReconnectTimer");
 
     xTimerStop(mqttReconnectTimer, 0); // ensure we don't reconnect to MQTT while reconnecting to Wi-Fi
-    Log.infoln("Reconnecting to WiFi...");
+    LOG_INFOLN("Reconnecting to WiFi...");
     xTimerStart(wifiReconnectTimer, 0);
     break;
 #else
 
   case SYSTEM_EVENT_STA_GOT_IP:
-    Log.infoln("WiFi connected");
-    Log.infoln("IP address: ");
-    Log.infoln(WiFi.localIP());
+    LOG_INFOLN("WiFi connected");
+    LOG_INFOLN("IP address: ");
+    LOG_INFOLN(WiFi.localIP());
     connectToMqtt();
     break;
 
   case SYSTEM_EVENT_STA_DISCONNECTED:
-    Log.infoln("WiFi lost connection");
+    LOG_INFOLN("WiFi lost connection");
     xTimerStop(mqttReconnectTimer, 0); // ensure we don't reconnect to MQTT while reconnecting to Wi-Fi
     xTimerStart(wifiReconnectTimer, 0);
     break;
@@ -407,196 +833,359 @@ void WiFiEvent(WiFiEvent_t event)
     break;
   }
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+  LOG_VERBOSELN("Exiting...");
 }
 
 void printSeparationLine()
 {
-  Log.infoln("************************************************");
+  LOG_INFOLN("************************************************");
 }
 
 void onMqttConnect(bool sessionPresent)
 {
-  String oldMethodName = methodName;
-  methodName = "onMqttConnect(bool sessionPresent)";
-  Log.verboseln("Entering...");
+  LogScope scope("onMqttConnect(bool sessionPresent)");
+  LOG_VERBOSELN("Entering...");
 
-  Log.infoln("Connected to MQTT broker: %p , port: %d", MQTT_HOST, MQTT_PORT);
-  Log.infoln("PubTopic:  %s", mainPubTopic);
+  LOG_INFOLN("Connected to MQTT broker: %p , port: %d", MQTT_HOST, MQTT_PORT);
+  LOG_INFOLN("PubTopic:  %s", mainPubTopic);
 
   // printSeparationLine();
-  Log.infoln("Session present: %T", sessionPresent);
+  LOG_INFOLN("Session present: %T", sessionPresent);
 
   uint16_t packetIdSub = mqttClient.subscribe(SubTopic, 2);
-  Log.infoln("Subscribing at QoS 2, packetId: %u", packetIdSub);
+  LOG_INFOLN("Subscribing at QoS 2, packetId: %u", packetIdSub);
 
   mqttClient.setWill(willTopic, 1, false, "1");
-  Log.infoln("Set Last Will and Testament message.");
+  LOG_INFOLN("Set Last Will and Testament message.");
 
   if (floorthermIndex == -1)
     xTimerStart(mqttRegisterIDTimer, 0);
   else
     publishIndex();
-  
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+  // Retained zone status may be stale after time offline
+  zoneStatusResync = true;
+
+  LOG_VERBOSELN("Exiting...");
 }
 
 void onMqttDisconnect(AsyncMqttClientDisconnectReason reason)
 {
-  String oldMethodName = methodName;
-  methodName = "onMqttDisconnect(AsyncMqttClientDisconnectReason reason)";
-  Log.verboseln("Entering...");
+  LogScope scope("onMqttDisconnect(AsyncMqttClientDisconnectReason reason)");
+  LOG_VERBOSELN("Entering...");
 
   (void)reason;
 
-  Log.warningln("Disconnected from MQTT.");
+  LOG_WARNINGLN("Disconnected from MQTT.");
 
   if (WiFi.isConnected())
   {
-    Log.infoln("Reconnecting to MQTT broker.");
+    LOG_INFOLN("Reconnecting to MQTT broker.");
     xTimerStart(mqttReconnectTimer, 0);
   }
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+  LOG_VERBOSELN("Exiting...");
 }
 
 void onMqttSubscribe(const uint16_t &packetId, const uint8_t &qos)
 {
-  String oldMethodName = methodName;
-  methodName = "onMqttSubscribe(const uint16_t &packetId, const uint8_t &qos)";
-  // methodName = __PRETTY_FUNCTION__;
+  LogScope scope("onMqttSubscribe(const uint16_t &packetId, const uint8_t &qos)");
 
-  Log.infoln("Subscribe acknowledged.");
-  // Log.infoln("  packetId: %u    qos:  %u", packetId, qos);
-
-  methodName = oldMethodName;
+  LOG_INFOLN("Subscribe acknowledged.");
+  // LOG_INFOLN("  packetId: %u    qos:  %u", packetId, qos);
 }
 
 void onMqttUnsubscribe(const uint16_t &packetId)
 {
-  String oldMethodName = methodName;
-  methodName = "onMqttUnsubscribe(const uint16_t &packetId)";
+  LogScope scope("onMqttUnsubscribe(const uint16_t &packetId)");
+
+  // LOG_INFOLN("Unsubscribe acknowledged.  packetId: %u", packetId);
+}
 
-  // Log.infoln("Unsubscribe acknowledged.  packetId: %u", packetId);
+void publishZoneAlarmMessage(int zone, const char *message)
+{
+  LogScope scope("publishZoneAlarmMessage()");
 
-  methodName = oldMethodName;
+  mqttClient.publish(zoneTable.alarmTopic[zone].c_str(), 0, false, message);
 }
 
-void publishZoneAlarmMessage(char *zoneName, char *message)
+void publishZoneAlarms()
 {
-  String oldMethodName = methodName;
-  methodName = "publishZoneAlarmMessage()";
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    const char *message = zoneAlarm[i].exchange(nullptr, std::memory_order_acquire);
+    if (message != nullptr)
+      publishZoneAlarmMessage(i, message);
+  }
+}
 
-  const char *slash = "/";
+void logMQTTMessage(char *topic, int len, char *payload)
+{
+  LogScope scope("logMQTTMessage(char *topic, int len, char *payload)");
+  LOG_INFOLN("Topic: %s", topic);
 
-  char *topic = strdup(alarmTopic);
-  strcat(topic, slash);
-  strcat(topic, zoneName);
+  // LOG_INFOLN("Payload Length: %d", len);
 
-  char *alarmMessage = message;
-  const char *msg = alarmMessage;
-  mqttClient.publish(topic, 0, false, alarmMessage);
+  if (!isNullorEmpty(payload))
+  {
+    LOG_VERBOSE("Payload: " CR);
+    LOG_VERBOSELN("%s", payload);
+  }
+}
+
+/**
+ * \return true if the MQTT client took the message
+ */
+bool publishHeatingStatus()
+{
+  LogScope scope("publishHeatingStatus()");
+  StageTimer timer(STAGE_PUBLISH_STATUS);
+  LOG_VERBOSELN("Entering...");
 
-  methodName = oldMethodName;
+  // Publish Status
+  size_t len;
+  const char *doc = cachedStatusJson(len);
+  logMQTTMessage((char *)statusTopic, len, (char *)doc);
+  LOG_INFOLN("Publishing Status at QoS 0");
+  bool sent = mqttClient.publish(statusTopic, 0, false, doc, len) != 0;
+  LOG_VERBOSELN("Exiting...");
+  return sent;
 }
 
-void logMQTTMessage(char *topic, int len, char *payload)
+bool zoneStatusChanged(const ZoneState &now, const ZoneState &sent)
 {
-  String oldMethodName = methodName;
-  methodName = "logMQTTMessage(char *topic, int len, char *payload)";
-  Log.infoln("Topic: %s", topic);
+  return (now.heating != sent.heating) ||
+         (now.heatEnable != sent.heatEnable) ||
+         (now.setTemp != sent.setTemp) ||
+         (fabsf(now.actualTemp - sent.actualTemp) >= STATUS_DEADBAND_F);
+}
 
-  // Log.infoln("Payload Length: %d", len);
+/**
+ * Publishes a retained floortherm/<zone>/status message for every zone
+ * whose state has moved since it was last sent. UI task only.
+ *
+ * \param force republish every zone regardless of change
+ */
+void publishZoneStatus(bool force)
+{
+  LogScope scope("publishZoneStatus()");
+  LOG_VERBOSELN("Entering...");
 
-  if (!isNullorEmpty(payload))
+  if (zoneStatusResync.exchange(false))
+    force = true;
+
+  ZoneSnapshot zs = zoneState.read();
+  char payload[ROOM_JSON_MAX];
+
+  for (size_t i = 0; i < ZONE_COUNT; i++)
   {
-    Log.verbose("Payload: " CR);
-    Log.verboseln("%s", payload);
+    if (!force && zoneStatusValid[i] && !zoneStatusChanged(zs.zone[i], zoneStatusSent[i]))
+      continue;
+
+    size_t len = getRoomStatusJson(zs.zone[i], payload, sizeof(payload));
+    LOG_INFOLN("Publishing %s status at QoS 0", zoneTable.name(i));
+    // Only remember what actually went out, so a dropped publish is retried
+    if (mqttClient.publish(zoneTable.statusTopic[i].c_str(), 0, true, payload, len) != 0)
+    {
+      zoneStatusSent[i] = zs.zone[i];
+      zoneStatusValid[i] = true;
+    }
   }
 
-  methodName = oldMethodName;
+  LOG_VERBOSELN("Exiting...");
 }
 
-String getRoomStatusJson(int i)
+/**
+ * Answers a bulk zone command with one full status document, and counts
+ * it as sent on every zone topic so the zones it changed don't each
+ * publish a delta as well. Those retained topics catch up at the next
+ * heartbeat. UI task only.
+ */
+void publishBulkStatus()
 {
-  String oldMethodName = methodName;
-  methodName = "getRoomStatusJson()";
-  Log.verboseln("Entering...");
+  LogScope scope("publishBulkStatus()");
+  LOG_VERBOSELN("Entering...");
 
-  StaticJsonDocument<roomDocCapacity> doc;
-  String payload;
+  if (publishHeatingStatus())
+  {
+    for (size_t i = 0; i < ZONE_COUNT; i++)
+    {
+      zoneStatusSent[i] = statusJsonState.zone[i];
+      zoneStatusValid[i] = true;
+    }
+  }
 
-  doc["CurrentTemp"] = zoneActualTemp[i];
-  doc["Enabled"] = zoneHeatEnable[i];
-  doc["SetTemp"] = zoneSetTemp[i];
-  doc["Heating"] = zoneHeating[i];
+  LOG_VERBOSELN("Exiting...");
+}
 
-  Log.infoln("Serializing Status JSON");
-  serializeJson(doc, payload);
+void onIgnoredMessage(const char *topic, char *msg, size_t len, intptr_t context)
+{
+  // Our own or another floortherm's status/metrics/alarm message
+}
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
-  return payload;
+void onAliveMessage(const char *topic, char *msg, size_t len, intptr_t context)
+{
+  LOG_VERBOSELN("Processing alive Topic");
+  int otherIndex = 0;
+  otherIndex = atoi(msg);
+  if ((indexWaitDone || (floorthermIndex > -1)) && (otherIndex == floorthermIndex))
+  {
+    LOG_INFOLN("Received own index: %d", otherIndex);
+  }
+  else
+  {
+    LOG_INFOLN("Found other floortherm with index: %d", otherIndex);
+    if (maxOtherIndex < otherIndex)
+      maxOtherIndex = otherIndex;
+  }
+}
+
+void onRestartMessage(const char *topic, char *msg, size_t len, intptr_t context)
+{
+  LOG_VERBOSELN("Processing Restart topic.");
+  int sentval = atoi(msg);
+  if (sentval == floorthermIndex)
+  {
+    LOG_WARNINGLN("It has our Index, so....");
+    LOG_WARNINGLN("Restarting !!!");
+    ESP.restart();
+  }
+}
+
+void onLogLevelMessage(const char *topic, char *msg, size_t len, intptr_t level)
+{
+  LOG_VERBOSELN("Topic matched Log Level %s", logLevelNames[level]);
+  int sentval = atoi(msg);
+  if (sentval == floorthermIndex)
+  {
+    LOG_VERBOSELN("It has our Index, so....");
+    LOG_VERBOSELN("Setting Log Level to %s", logLevelNames[level]);
+    if (level > LOG_COMPILED_LEVEL)
+      LOG_WARNINGLN("Log Level %s not compiled in, using %s", logLevelNames[level], logLevelNames[LOG_COMPILED_LEVEL]);
+    Log.setLevel(level);
+    logLevel = Log.getLevel();
+    prefsStorePending = true;
+  }
 }
 
-String getStatusJson()
+void onLogFormatMessage(const char *topic, char *msg, size_t len, intptr_t binary)
 {
-  String oldMethodName = methodName;
-  methodName = "getStatusJson()";
-  Log.verboseln("Entering...");
+  int sentval = atoi(msg);
+  if (sentval == floorthermIndex)
+  {
+    LOG_INFOLN("Switching to %s log records", binary ? "binary" : "text");
+    Log.setBinary(binary);
+  }
+}
+
+void onDisplayMessage(const char *topic, char *msg, size_t len, intptr_t on)
+{
+  int sentval = atoi(msg);
+  if (sentval == floorthermIndex)
+  {
+    LOG_INFOLN("Turning display %s", on ? "on" : "off");
+    displayBlanked = !on;
+  }
+}
 
-  StaticJsonDocument<docCapacity> doc;
-  String payload;
+void onHistoryGetMessage(const char *topic, char *msg, size_t len, intptr_t context)
+{
+  int sentval = -1;
+  unsigned long from = 0;
+  unsigned long to = UINT32_MAX;
+  if ((sscanf(msg, "%d %lu %lu", &sentval, &from, &to) >= 1) && (sentval == floorthermIndex))
+  {
+    if (!historyQueries.push({(uint32_t)from, (uint32_t)to}))
+      LOG_WARNINGLN("History query queue full, dropping query");
+  }
+}
 
-  for (int i = 0; i < 5; i++)
+void onSummaryGetMessage(const char *topic, char *msg, size_t len, intptr_t context)
+{
+  int sentval = -1;
+  unsigned int periodMin = 0;
+  unsigned int count = 0;
+  if ((sscanf(msg, "%d %u %u", &sentval, &periodMin, &count) >= 2) && (sentval == floorthermIndex))
   {
-    doc[zoneNames[i]]["CurrentTemp"] = zoneActualTemp[i];
-    doc[zoneNames[i]]["Enabled"] = zoneHeatEnable[i];
-    doc[zoneNames[i]]["SetTemp"] = zoneSetTemp[i];
-    doc[zoneNames[i]]["Heating"] = zoneHeating[i];
+    if (!summaryRequests.push({(uint16_t)periodMin, (uint16_t)count}))
+      LOG_WARNINGLN("Summary request queue full, dropping request");
   }
+}
 
-  Log.infoln("Serializing Status JSON");
-  serializeJson(doc, payload);
+void onMetricsGetMessage(const char *topic, char *msg, size_t len, intptr_t context)
+{
+  if (atoi(msg) == floorthermIndex)
+    metricsPublishPending = true;
+}
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
-  return payload;
+void onTraceGetMessage(const char *topic, char *msg, size_t len, intptr_t context)
+{
+  int sentval = -1;
+  char target[8] = "";
+  if ((sscanf(msg, "%d %7s", &sentval, target) >= 1) && (sentval == floorthermIndex))
+    traceRequest = strcmp(target, "serial") ? TRACE_MQTT : TRACE_SERIAL;
 }
 
-void publishHeatingStatus()
+void onGetStatusMessage(const char *topic, char *msg, size_t len, intptr_t context)
 {
-  String oldMethodName = methodName;
-  methodName = "publishHeatingStatus()";
-  Log.verboseln("Entering...");
+  LOG_VERBOSELN("Processing GET command!");
+  // Publish Heating Status from the UI task, which owns the cached JSON
+  statusPublishPending = true;
+}
 
-  // Publish Status
-  String oDoc = getStatusJson();
-  const char *doc = oDoc.c_str();
-  logMQTTMessage((char *)statusTopic, strlen(doc), (char *)doc);
-  Log.infoln("Publishing Status at QoS 0");
-  mqttClient.publish(statusTopic, 0, false, doc);
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+// Indexed by TopicAction, see topicRoutes[] in Topics.h
+const TopicHandler topicHandlers[] = {
+    onIgnoredMessage,
+    onAliveMessage,
+    onRestartMessage,
+    onGetStatusMessage,
+    onZonesSetMessage,
+    onDisplayMessage,
+    onLogFormatMessage,
+    onLogLevelMessage,
+    onHistoryGetMessage,
+    onSummaryGetMessage,
+    onMetricsGetMessage,
+    onTraceGetMessage};
+static_assert(sizeof(topicHandlers) / sizeof(topicHandlers[0]) == (size_t)TopicAction::Count,
+              "One handler per TopicAction");
+
+void addTopicRoute(const char *topic, TopicHandler handler, intptr_t context = 0)
+{
+  if (!topicRouter.add(topic, handler, context))
+    LOG_ERRORLN("Could not route topic %s", topic);
 }
 
-void turnOffHeating(int i)
+void setupTopicRoutes()
 {
-  zoneHeating[i] = false;
-  zoneHeatingMode[i] = "OFF";
-  digitalWrite(outPins[i], 0);
+  LogScope scope("setupTopicRoutes()");
+  LOG_VERBOSELN("Entering...");
+
+  for (const TopicRouteDef &route : topicRoutes)
+  {
+    TopicHandler handler = topicHandlers[(size_t)route.action];
+    if (!route.pattern)
+      addTopicRoute(route.topic, handler, route.context);
+    else if (!topicRouter.addPattern(route.topic, handler, route.context))
+      LOG_ERRORLN("Could not route pattern %s", route.topic);
+  }
+
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    addTopicRoute(zoneTable.setPointTopic[i].c_str(), onSetPointMessage, i);
+    addTopicRoute(zoneTable.enableTopic[i].c_str(), onEnableMessage, i);
+  }
+
+  LOG_INFOLN("Routing %d MQTT topics", (int)topicRouter.size());
+
+  LOG_VERBOSELN("Exiting...");
 }
 
 void onMqttMessage(char *topic, char *payload, const AsyncMqttClientMessageProperties &properties,
                    const size_t &len, const size_t &index, const size_t &total)
 {
-  String oldMethodName = methodName;
-  methodName = "onMqttMessage()";
-  Log.verboseln("Entering...");
+  LogScope scope("onMqttMessage()");
+  LOG_VERBOSELN("Entering...");
 
   // This safely extracts the proper payload message
   //(void)payload;
@@ -604,379 +1193,547 @@ void onMqttMessage(char *topic, char *payload, const AsyncMqttClientMessagePrope
   memcpy(msg, payload, len);
   msg[len] = 0;
 
-  String recTopic = String(topic);
-  bool foundZone = false;
-
+  const TopicRoute *route = topicRouter.find(topic);
 
-  if (strcmp(topic, statusTopic) == 0) // This is a status message
+  if (route == NULL)
   {
-    // This is our own or another floortherm's status message, so ignore
-    Log.verboseln("Ignoring Status Topic.");
-    Log.verboseln("Exiting...");
-    methodName = oldMethodName;
-    return;
+    logMQTTMessage(topic, len, msg);
+    // Unsupported or unknown command
+    LOG_WARNINGLN("Unsupported or unknown command!!!   ---> %s", topic);
   }
-
-  logMQTTMessage(topic, len, msg);
-
-  if (strcmp(topic, aliveTopic) == 0) // This is an alive message from other floortherms
+  else if (route->handler == onIgnoredMessage)
   {
-    Log.verboseln("Processing alive Topic");
-    int otherIndex = 0;
-    otherIndex = atoi(msg);
-    if ((indexWaitDone || (floorthermIndex > -1)) && (otherIndex == floorthermIndex))
-    {
-      Log.infoln("Received own index: %d", otherIndex);
-    }
-    else
-    {
-      Log.infoln("Found other floortherm with index: %d", otherIndex);
-      if (maxOtherIndex < otherIndex)
-        maxOtherIndex = otherIndex;
-    }
+    LOG_VERBOSELN("Ignoring Status Topic.");
   }
-  else if (strcmp(topic, restartTopic) == 0)
+  else
   {
-    Log.verboseln("Processing Restart topic.");
-    int sentval = atoi(msg);
-    if (sentval == floorthermIndex)
-    {
-      Log.warningln("It has our Index, so....");
-      Log.warningln("Restarting !!!");
-      ESP.restart();
-    }
+    logMQTTMessage(topic, len, msg);
+    route->handler(topic, msg, len, route->context);
   }
-  else if (strstr(topic, logLevelTopic) != NULL)
+
+  LOG_VERBOSELN("Exiting...");
+}
+
+void onMqttPublish(const uint16_t &packetId)
+{
+  LogScope scope("onMqttPublish()");
+  // LOG_INFOLN("Publish acknowledged.  packetId: %s", packetId);
+}
+
+void taskLoadAdd(TaskLoad &load, uint32_t startUs)
+{
+  uint32_t now = micros();
+  load.busyUs += now - startUs;
+  load.passes++;
+
+  uint32_t window = now - load.windowStartUs;
+  if (window >= TASK_LOAD_WINDOW_US)
   {
-    Log.verboseln("Processing Log Level topic.");
-    for (int l = 0; l < 7; l++)
-    {
-      Log.verboseln("Matching Topic:%s to %s", topic, logLevelNames[l]);
-      if (strstr(topic, logLevelNames[l]) != NULL)
-      {
-        Log.verboseln("Topic matched Log Level %s", logLevelNames[l]);
-        int sentval = atoi(msg);
-        if (sentval == floorthermIndex)
-        {
-          Log.verboseln("It has our Index, so....");
-          Log.verboseln("Setting Log Level to %s", logLevelNames[l]);
-          logLevel = l;
-          Log.setLevel(logLevel);
-          storePrefs();
-        }
-      }
-    }
+    uint32_t allocs = allocCount(load.handle);
+    load.cpuPercent = 100.0f * load.busyUs / window;
+    load.allocsPerPass = (float)(allocs - load.windowAllocs) / load.passes;
+    load.busyUs = 0;
+    load.passes = 0;
+    load.windowAllocs = allocs;
+    load.windowStartUs = now;
   }
-  else if (strcmp(topic, getStatusTopic) == 0) // This is a request for status
+}
+
+void samplerTask(void *parameter)
+{
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;)
   {
-    Log.verboseln("Processing GET command!");
-    // Publish Heating Status
-    publishHeatingStatus();
+    uint32_t start = micros();
+    sampleZones();
+    taskLoadAdd(samplerLoad, start);
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SAMPLE_PERIOD_MS));
   }
-  else
-  {
-    bool foundMatchingZone = false;
-    Log.verboseln("None of the other commands, so check Zone commands.");
-    for (int i = 0; i < 5; i++)
-    {
-      // String
-      Log.verboseln("Checking for Zone %s topics", zoneNames[i]);
+}
 
-      if (strcmp(topic, setPointTopics[i]) == 0)
-      {
-        Log.verboseln("Processing SetPoint command for Zone %s", zoneNames[i]);
-        foundMatchingZone = true;
-        int sentval = atoi(msg);
-        if (zoneSetTemp[i] != sentval)
-        {
-          // Send MQTT message that Set Temp Changed
-          Log.infoln("%s Set Temp changed: %d ---> %d", zoneNames[i], zoneSetTemp[i], sentval);
-          zoneSetTemp[i] = sentval;
-          turnOffHeating(i);
-          publishHeatingStatus();
-          storePrefs();
-        }
-      }
-      else if (strcmp(topic, enableTopics[i]) == 0)
-      {
-        Log.verboseln("Processing Heat Enable command for Zone %s", zoneNames[i]);
-        foundMatchingZone = true;
-        int sentval = atoi(msg);
-        if (zoneHeatEnable[i] != (bool)sentval)
-        {
-          // Send MQTT message that Enabled State Changed
-          Log.infoln("%s enable State Changed from %T ----> %T", zoneNames[i], zoneHeatEnable[i], sentval);
-          zoneHeatEnable[i] = (bool)sentval;
-          turnOffHeating(i);
-          publishHeatingStatus();
-          storePrefs();
-        }
-      }
-    }
+void startSampler()
+{
+  LogScope scope("startSampler()");
+  LOG_VERBOSELN("Entering...");
 
-    if (!foundMatchingZone)
-    {
-      // Unsupported or unknown command
-      Log.warningln("Unsupported or unknown command!!!   ---> %s", topic);
-    }
-  }
+  // Prime the rings synchronously so the first GetTemps() has real data
+  sampleZones();
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+  LOG_INFOLN("Starting background sampler (%d ms period, %d sample window)", SAMPLE_PERIOD_MS, SAMPLE_DEPTH);
+  xTaskCreatePinnedToCore(samplerTask, samplerLoad.name, 2048, NULL, SAMPLER_PRIORITY, &samplerLoad.handle, samplerLoad.core);
+  allocCounterWatch(samplerLoad.handle);
+
+  LOG_VERBOSELN("Exiting...");
 }
 
-void onMqttPublish(const uint16_t &packetId)
+void logHeatingStatus()
 {
-  String oldMethodName = methodName;
-  methodName = "onMqttPublish()";
-  // Log.infoln("Publish acknowledged.  packetId: %s", packetId);
+  LogScope scope("logHeatingStatus()");
+  // LOG_VERBOSELN("Entering...");
+  String statusMessage = "Status:\n";
+  ZoneSnapshot zs = zoneState.read();
 
-  methodName = oldMethodName;
-}
+  for (size_t j = 0; j < ZONE_COUNT; j++)
+  {
+    String err = "";
+    if ((!zs.zone[j].heatEnable && zs.zone[j].heating) || ((zs.zone[j].actualTemp > 90) && zs.zone[j].heating))
+      err = "!!! ERROR !!!";
 
-float ConvertValToTemp(int Vo)
-{
-  String oldMethodName = methodName;
-  methodName = "ConvertValToTemp(int Vo)";
-  Log.verboseln("Entering...");
+    String heating = "IDLE";
+    if (zs.zone[j].heating)
+      heating = "HEATING";
 
-  float Vout, Rt = 0;
-  float T, Tc, Tf = 0;
+    LOG_INFOLN("%s: Enabled: %T     Current: %F     Target: %i     Heating: %s     %s", zoneTable.name(j), zs.zone[j].heatEnable, zs.zone[j].actualTemp, zs.zone[j].setTemp, heating.c_str(), err.c_str());
+  }
+
+  LOG_VERBOSELN("Exiting...");
+}
 
-  Vout = Vo * Vs / adcMax;
-  Rt = Rref * Vout / (Vs - Vout);
-  T = 1 / (1 / To + log(Rt / Ro) / Beta); // Temperature in Kelvin
-  Tc = T - 273.15;                        // Celsius
-  Tf = Tc * 9 / 5 + 32;                   // Fahrenheit
+HeatingMode displayMode(const ZoneState &zone)
+{
+  if (!zone.heatEnable)
+    return HeatingMode::Off;
+  return zone.heating ? HeatingMode::Heating : HeatingMode::Idle;
+}
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
-  return Tf;
+void drawZoneName(int row, int zone)
+{
+  int y = DISPLAY_ROW_TOP + row * DISPLAY_ROW_PITCH;
+  display.fillRect(0, y, DISPLAY_VALUE_X, 8, BLACK);
+  if (zone >= 0)
+  {
+    display.setCursor(1, y);
+    display.print(zoneTable.name(zone));
+  }
+  display.markDirty(0, y, DISPLAY_VALUE_X, 8);
 }
 
-void GetTemps()
+void drawZoneValues(int row, const DisplayRow &shown)
 {
-  String oldMethodName = methodName;
-  methodName = "GetTemps()";
-  Log.verboseln("Entering...");
+  int x = DISPLAY_VALUE_X;
+  int y = DISPLAY_ROW_TOP + row * DISPLAY_ROW_PITCH;
+  display.fillRect(x, y, SCREEN_WIDTH - x, 8, BLACK);
+  display.markDirty(x, y, SCREEN_WIDTH - x, 8);
+  if (shown.zone < 0)
+    return;
 
-  Log.verboseln("Reading Temps");
+  display.setCursor(x, y);
+  display.print(shown.temp);
+  display.print("F");
 
-  for (int i = 0; i < 5; i++)
+  x += 15;
+  if (shown.mode == HeatingMode::Heating)
   {
-    int avg = 0;
-    for (int j = 0; j < 10; j++)
-    {
-      int readVal = analogRead(inPins[i]);
-      avg += readVal;
-      delay(10);
-    }
-    zoneReadVal[i] = avg / 10.0;
-    zoneActualTemp[i] = ConvertValToTemp(zoneReadVal[i]);
+    display.setCursor(x + 5 * (shown.arrow + 1), y);
+    display.print(">");
+    x += 45;
+  }
+  else if (shown.mode == HeatingMode::Idle)
+  {
+    display.setCursor(x + 25, y);
+    display.print("IDLE");
+    x += 55;
+  }
+  else
+  {
+    display.setCursor(x + 40, y);
+    display.print("OFF");
+    return;
   }
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+  display.setCursor(x + 10, y);
+  display.print(shown.setTemp);
+  display.print("F");
 }
 
-void SetHeatControl()
+size_t displayPageAt(unsigned long now)
 {
-  String oldMethodName = methodName;
-  methodName = "SetHeatControl()";
-  Log.verboseln("Entering...");
+  // Page through the zones when they don't all fit under the title
+  const size_t pages = (ZONE_COUNT + DISPLAY_ZONE_ROWS - 1) / DISPLAY_ZONE_ROWS;
+  return (now / DISPLAY_PAGE_MS) % pages;
+}
 
-  for (int i = 0; i < 5; i++)
+/**
+ * Works out what each zone row shows for a zone state, page and arrow step.
+ * \return true if a row is animating
+ */
+bool buildDisplayRows(const ZoneSnapshot &zs, size_t page, uint32_t arrowTick, DisplayRow *rows)
+{
+  bool animating = false;
+  const size_t first = page * DISPLAY_ZONE_ROWS;
+  for (int r = 0; r < DISPLAY_ZONE_ROWS; r++)
   {
-    if (zoneActualTemp[i] < 90)
+    size_t j = first + r;
+    DisplayRow shown = {-1, 0, 0, HeatingMode::Off, 0};
+    if (j < ZONE_COUNT)
     {
-      char zAT[20];
-     sprintf(zAT,"%.2f", zoneActualTemp[i]);
-      Log.verboseln("Zone %s temp = %f  < 90F", zoneNames[i], zAT);
-      // Are we allowed to heat?
-      if (zoneHeatEnable[i])
-      { // Yes - Decide if we should heat.
-        Log.verboseln("Zone %s Heating Enabled", zoneNames[i]);
-        // Cool enough to think about heating?
-        if ((zoneActualTemp[i] <= (zoneSetTemp[i] + 0.5)))
-        { // Yes - Decide whether to turn on heat.
-          Log.verboseln("Zone %s temperature is below set point", zoneNames[i]);
-          // Cool enough to turn on heat?
-          if (zoneActualTemp[i] < (zoneSetTemp[i] - 0.5))
-          { // Yes - Heat it up!
-            Log.verboseln("%s HEATING", zoneNames[i]);
-            zoneHeating[i] = true;
-            zoneHeatingMode[i] = "HEATING";
-          }
-          else
-          { // No - We're in the zone (+/- 0.5F). No change until upper or lower bound is reached.
-            // IDLE - if it is ON, leave it on i.e. still Heating
-            //        if it is OFF, leave it OFF i.e. cooling down from (zoneSetTemp[i] +1)
-            // zoneHeatingMode[i] = "IDLE";
-            Log.verboseln("Zone %s between +/- 0.5F of set point so no change.", zoneNames[i]);
-          }
-        }
-        else
-        { // No - Hot enough, stop heating.
-          Log.verboseln("Zone %s temperature is above set point so turning off heating - IDLE", zoneNames[i]);
-          zoneHeating[i] = false;
-          zoneHeatingMode[i] = "IDLE";
-        }
-      }
-      else // NOT zoneHeatEnable[i]
+      shown.zone = j;
+      shown.temp = lroundf(zs.zone[j].actualTemp);
+      shown.setTemp = zs.zone[j].setTemp;
+      shown.mode = displayMode(zs.zone[j]);
+      if (shown.mode == HeatingMode::Heating)
       {
-        const char *warningMessage = "Unrequested Heating!!!";
-        if (zoneHeating[i])
-        {
-          Log.warningln("!!! ERROR !!! %s", warningMessage);
-          // Should also send MQTT message to alert someone
-          publishZoneAlarmMessage(strdup(zoneNames[i]), strdup(warningMessage));
-        }
-        // Log.warningln("!!! ERROR !!! %s - Shutting OFF %s", warningMessage, zoneNames[i]);
-        zoneHeating[i] = false;
-        zoneHeatingMode[i] = "OFF";
+        // Animation runs off the clock, not the frame or sample rate
+        shown.arrow = arrowTick % 9;
+        animating = true;
       }
-
-      //****************************************
-      // The ONLY place that heating gets written
-      //
-      digitalWrite(outPins[i], zoneHeating[i]);
-      //
-      // ***************************************
-    }
-    else
-    {
-      const char *warningMessage = "OVERHEATING";
-      Log.verboseln("!!! ERROR !!! %s", warningMessage);
-      // Should also send MQTT message to alert someone
-      publishZoneAlarmMessage(strdup(zoneNames[i]), strdup(warningMessage));
-
-      Log.verboseln("!!! ERROR !!! %s - Shutting OFF %s", warningMessage, zoneNames[i]);
-      zoneHeating[i] = false;
-      zoneHeatingMode[i] = "OFF";
     }
+    rows[r] = shown;
   }
+  return animating;
+}
+
+bool displayFrameDue(unsigned long now)
+{
+  if (displayFullRedraw)
+    return true;
+
+  // Nothing the rows are built from has moved on
+  if ((zoneState.version() == displayVersion) &&
+      (displayPageAt(now) == displayPage) &&
+      (!displayAnimating || (now / DISPLAY_ARROW_MS == displayArrowTick)))
+    return false;
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+  // Something has, but most reading changes don't move a whole degree, so
+  // only send a frame if the rows would look different
+  ZoneSnapshot zs;
+  displayVersion = zoneState.read(zs);
+  displayPage = displayPageAt(now);
+  displayArrowTick = now / DISPLAY_ARROW_MS;
+  DisplayRow rows[DISPLAY_ZONE_ROWS];
+  displayAnimating = buildDisplayRows(zs, displayPage, displayArrowTick, rows);
+  return memcmp(rows, displayRows, sizeof(rows)) != 0;
 }
 
-void logHeatingStatus()
+void displayHeatingStatus(unsigned long now)
 {
-  String oldMethodName = methodName;
-  methodName = "logHeatingStatus()";
-  // Log.verboseln("Entering...");
-  String statusMessage = "Status:\n";
+  LogScope scope("displayHeatingStatus()");
+  StageTimer timer(STAGE_DISPLAY);
+  LOG_VERBOSELN("Entering...");
+
+  uint32_t start = micros();
+  ZoneSnapshot zs;
+  displayVersion = zoneState.read(zs);
+  displayPage = displayPageAt(now);
+  displayArrowTick = now / DISPLAY_ARROW_MS;
+  DisplayRow rows[DISPLAY_ZONE_ROWS];
+  displayAnimating = buildDisplayRows(zs, displayPage, displayArrowTick, rows);
+
+  if (displayFullRedraw)
+  {
+    display.clearDisplay();
+    display.setCursor(35, 1);
+    display.print("FloorTherm");
+    for (int r = 0; r < DISPLAY_ZONE_ROWS; r++)
+      displayRows[r].zone = -1;
+  }
 
-  for (int j = 0; j < 5; j++)
+  // Only redraw the cells whose content changed since they were last drawn
+  for (int r = 0; r < DISPLAY_ZONE_ROWS; r++)
   {
-    String err = "";
-    if ((!zoneHeatEnable[j] && zoneHeating[j]) || ((zoneActualTemp[j] > 90) && zoneHeating[j]))
-      err = "!!! ERROR !!!";
+    const DisplayRow &shown = rows[r];
+    DisplayRow &drawn = displayRows[r];
+    if (displayFullRedraw || (shown.zone != drawn.zone))
+      drawZoneName(r, shown.zone);
+    if (displayFullRedraw || memcmp(&shown, &drawn, sizeof(shown)) != 0)
+      drawZoneValues(r, shown);
+    drawn = shown;
+  }
 
-    String heating = "IDLE";
-    if (zoneHeating[j])
-      heating = "HEATING";
+  size_t sent = displayFullRedraw ? display.displayFull() : display.displayDirty();
+  displayFullRedraw = false;
+
+  displayStats.frames++;
+  displayStats.i2cBytes += sent;
+  displayStats.renderUs += micros() - start;
+
+  LOG_VERBOSELN("Exiting...");
+}
+
+void publishTaskMetrics()
+{
+  LogScope scope("publishTaskMetrics()");
+  LOG_VERBOSELN("Entering...");
+
+  StaticJsonDocument<JSON_OBJECT_SIZE(9) + JSON_OBJECT_SIZE(4) + 4 * JSON_OBJECT_SIZE(4) + 2 * JSON_OBJECT_SIZE(5) +
+                     JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(STAGE_COUNT) + STAGE_COUNT * JSON_OBJECT_SIZE(5)>
+      doc;
+  char payload[1280];
+
+  JsonObject tasks = doc.createNestedObject("Tasks");
+  for (TaskLoad *load : taskLoads)
+  {
+    JsonObject t = tasks.createNestedObject(load->name);
+    t["Core"] = load->core;
+    t["Cpu"] = load->cpuPercent;
+    t["StackFree"] = load->handle ? uxTaskGetStackHighWaterMark(load->handle) : 0;
+    t["Allocs"] = load->allocsPerPass;
+    LOG_INFOLN("Task %s: core %d, CPU %F%%", load->name, load->core, load->cpuPercent);
+  }
 
-    Log.infoln("%s: Enabled: %T     Current: %F     Target: %i     Heating: %s     %s", zoneNames[j], zoneHeatEnable[j], zoneActualTemp[j], zoneSetTemp[j], heating.c_str(), err.c_str());
+  // Legacy renderer cleared and pushed the full frame twice per refresh
+  uint32_t frames = displayStats.frames.exchange(0);
+  uint32_t skipped = displayStats.skipped.exchange(0);
+  uint32_t i2cBytes = displayStats.i2cBytes.exchange(0);
+  uint32_t renderUs = displayStats.renderUs.exchange(0);
+  doc["LogDropped"] = asyncLog.dropped();
+  doc["MqttLogDropped"] = mqttLog.dropped();
+  doc["FlashWrites"] = prefsFlashWrites;
+
+  JsonObject disp = doc.createNestedObject("Display");
+  disp["Frames"] = frames;
+  disp["Skipped"] = skipped;
+  disp["BytesPerFrame"] = frames ? i2cBytes / frames : 0;
+  disp["RenderUs"] = frames ? renderUs / frames : 0;
+  disp["LegacyBytesPerFrame"] = 2 * display.fullFrameBytes();
+  JsonObject hist = doc.createNestedObject("History");
+  hist["Samples"] = history.samples();
+  hist["BytesPerSample"] = history.bytesPerSample();
+  hist["AppendUs"] = historyAppendUs;
+  hist["FlashBytes"] = historySegments.bytesUsed();
+  hist["Lost"] = history.lost();
+
+  JsonObject heap = doc.createNestedObject("Heap");
+  heap["Free"] = ESP.getFreeHeap();
+  heap["Largest"] = ESP.getMaxAllocHeap();
+  heap["MinFree"] = ESP.getMinFreeHeap();
+
+  // Stage run times since the last publish
+  uint32_t now = millis();
+  doc["WindowMs"] = now - stageWindowStart;
+  stageWindowStart = now;
+  JsonObject stages = doc.createNestedObject("Stages");
+  for (size_t i = 0; i < STAGE_COUNT; i++)
+  {
+    StageHistogram::Snapshot s;
+    stageUs[i].take(s);
+    JsonObject st = stages.createNestedObject(stageNames[i]);
+    st["Count"] = s.count;
+    st["MinUs"] = s.min;
+    st["MeanUs"] = s.mean();
+    st["P99Us"] = s.quantile(0.99f);
+    st["MaxUs"] = s.max;
+    LOG_INFOLN("Stage %s: %d runs, mean %d us, p99 %d us, max %d us", stageNames[i], (int)s.count, (int)s.mean(),
+               (int)s.quantile(0.99f), (int)s.max);
   }
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+  LOG_INFOLN("Display: %d frames, %d skipped, %d I2C bytes, %d us per frame", (int)frames, (int)skipped,
+             (int)(frames ? i2cBytes / frames : 0), (int)(frames ? renderUs / frames : 0));
+
+  serializeJson(doc, payload, sizeof(payload));
+  mqttClient.publish(metricsTopic, 0, false, payload);
+
+  LOG_VERBOSELN("Exiting...");
+}
+
+void addHistogramJson(JsonObject &obj, ControlHistogram &hist)
+{
+  ControlHistogram::Snapshot s;
+  hist.take(s);
+  obj["MaxUs"] = s.max;
+  obj["MeanUs"] = s.mean();
+  JsonArray bins = obj.createNestedArray("Hist");
+  for (size_t i = 0; i < ControlHistogram::bins(); i++)
+    bins.add(s.bins[i]);
 }
 
-void displayHeatingStatus()
+void publishControlMetrics()
 {
-  String oldMethodName = methodName;
-  methodName = "displayHeatingStatus()";
-  Log.verboseln("Entering...");
+  LogScope scope("publishControlMetrics()");
+  LOG_VERBOSELN("Entering...");
 
-  int x = 35;
-  int y = 1;
+  StaticJsonDocument<JSON_OBJECT_SIZE(5) + 2 * JSON_OBJECT_SIZE(3) + 3 * JSON_ARRAY_SIZE(CONTROL_HIST_BINS)> doc;
+  char payload[512];
 
-  display.clearDisplay();
-  display.display();
-  display.setCursor(x, y);
-  display.print("FloorTherm");
-  y = 15;
-  for (int j = 0; j < 5; j++)
+  uint32_t overruns = controlStats.overruns.exchange(0);
+  doc["PeriodUs"] = CONTROL_PERIOD_MS * 1000;
+  doc["Overruns"] = overruns;
+
+  // Bin upper bounds, the last bin is open ended
+  JsonArray edges = doc.createNestedArray("BinUs");
+  for (size_t i = 0; i + 1 < ControlHistogram::bins(); i++)
+    edges.add(ControlHistogram::upperBound(i));
+
+  JsonObject jitter = doc.createNestedObject("Jitter");
+  addHistogramJson(jitter, controlStats.jitterUs);
+  JsonObject exec = doc.createNestedObject("Exec");
+  addHistogramJson(exec, controlStats.execUs);
+
+  if (overruns > 0)
+    LOG_WARNINGLN("Control task overran its %d ms period %d times", CONTROL_PERIOD_MS, (int)overruns);
+  LOG_INFOLN("Control tick: jitter max %d us, run time max %d us", jitter["MaxUs"].as<int>(), exec["MaxUs"].as<int>());
+
+  serializeJson(doc, payload, sizeof(payload));
+  mqttClient.publish(controlMetricsTopic, 0, false, payload);
+
+  LOG_VERBOSELN("Exiting...");
+}
+
+void controlTask(void *parameter)
+{
+  TickType_t lastWake = xTaskGetTickCount();
+  uint32_t dueUs = 0;
+  bool resync = true;
+  for (;;)
   {
-    x = 1;
-    display.setCursor(x, y);
-    display.print(zoneNames[j]);
+    // Wait first, so every pass starts on a tick boundary
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(CONTROL_PERIOD_MS));
 
-    // Log.infoln();
+    uint32_t start = micros();
+    if (resync)
+      dueUs = start;
+    else
+      controlStats.jitterUs.add((int32_t)(start - dueUs) > 0 ? start - dueUs : 0);
+    resync = false;
+    dueUs += CONTROL_PERIOD_MS * 1000;
+    scopeTraceRecord("controlTask()", 'B');
 
-    x += 35;
-    display.setCursor(x, y);
-    display.print(zoneActualTemp[j], 0);
-    display.print("F");
+    applyZoneCommands();
+    {
+      StageTimer timer(STAGE_GET_TEMPS);
+      GetTemps();
+    }
+    {
+      StageTimer timer(STAGE_SET_HEAT);
+      SetHeatControl();
+    }
+    aggregateZones();
+    publishZoneState();
+
+    scopeTraceRecord("controlTask()", 'E');
+    controlStats.execUs.add(micros() - start);
+    taskLoadAdd(controlLoad, start);
 
-    x += 15;
-    display.setCursor(x, y);
-    if (zoneHeatEnable[j])
+    if ((int32_t)(micros() - dueUs) >= 0)
     {
-      if (zoneHeating[j])
-      {
-        // display.print("HEATING");
-        for (int k = 0; k < 9; k++)
-        {
-          x += 5;
-          if (k == zoneHeatArrowCounter[j])
-          {
-            display.setCursor(x, y);
-            display.print(">");
-          }
-        }
-        zoneHeatArrowCounter[j]++;
-        if (zoneHeatArrowCounter[j] > 8)
-        {
-          zoneHeatArrowCounter[j] = 0;
-        }
-      }
-      else
-      {
-        x += 25;
-        display.setCursor(x, y);
-        display.print("IDLE");
-        x += 30;
-      }
-      x += 10;
-      display.setCursor(x, y);
-      display.print(zoneSetTemp[j], 0);
-      display.print("F");
+      // Past the next tick already. Drop the missed ticks instead of
+      // running them back to back, and measure from the new phase.
+      controlStats.overruns++;
+      lastWake = xTaskGetTickCount();
+      resync = true;
+    }
+  }
+}
+
+void uiTask(void *parameter)
+{
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;)
+  {
+    uint32_t start = micros();
+    scopeTraceRecord("uiTask()", 'B');
+
+    publishZoneAlarms();
+    if (statusPublishPending.exchange(false))
+      publishHeatingStatus();
+#ifdef STATUS_PUBLISH_DELTA
+    if (bulkStatusPending.exchange(false))
+      publishBulkStatus();
+#endif
+    servicePrefs(millis());
+    serviceHistory();
+    serviceAggregates();
+    serviceTrace();
+#ifdef STATUS_PUBLISH_DELTA
+    if (mqttClient.connected())
+      publishZoneStatus(false);
+#endif
+
+    ledOn = !ledOn;
+    digitalWrite(LED_PIN, ledOn);
 
-      x += 10;
-      display.setCursor(x, y);
+    unsigned long rightNow = millis();
+    if (rightNow - lastLogBroadcast >= METRICS_PERIOD_MS)
+    {
+      logHeatingStatus();
+      publishTaskMetrics();
+      publishControlMetrics();
+      lastLogBroadcast = rightNow;
     }
-    else
+    else if (metricsPublishPending.exchange(false))
+      publishTaskMetrics();
+
+#ifdef STATUS_PUBLISH_DELTA
+    if (rightNow - lastStatusBroadcast >= STATUS_HEARTBEAT_MS)
+    {
+      // Heartbeat - full document plus every zone, so consumers can resync
+      publishHeatingStatus();
+      zoneStatusResync = true;
+      lastStatusBroadcast = rightNow;
+    }
+#else
+    if (rightNow - lastStatusBroadcast >= STATUS_BROADCAST_MS)
+    {
+      publishHeatingStatus();
+      lastStatusBroadcast = rightNow;
+    }
+#endif
+
+    scopeTraceRecord("uiTask()", 'E');
+    taskLoadAdd(uiLoad, start);
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(UI_PERIOD_MS));
+  }
+}
+
+void displayTask(void *parameter)
+{
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;)
+  {
+    uint32_t start = micros();
+    scopeTraceRecord("displayTask()", 'B');
+
+    bool blank = displayBlanked;
+    if (blank != displayIsBlank)
     {
-      x += 40;
-      display.setCursor(x, y);
-      display.print("OFF");
+      // Panel keeps its RAM while off, so the retained rows stay valid
+      display.ssd1306_command(blank ? SSD1306_DISPLAYOFF : SSD1306_DISPLAYON);
+      displayIsBlank = blank;
     }
-    y += 10;
+
+    unsigned long now = millis();
+    if (!blank && displayFrameDue(now))
+      displayHeatingStatus(now);
+    else
+      displayStats.skipped++;
+
+    scopeTraceRecord("displayTask()", 'E');
+    taskLoadAdd(displayLoad, start);
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(1000 / DISPLAY_FPS));
   }
-  display.display();
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+}
+
+void startTasks()
+{
+  LogScope scope("startTasks()");
+  LOG_VERBOSELN("Entering...");
+
+  LOG_INFOLN("Starting control task on core %d, UI and display tasks on core %d", CONTROL_CORE, UI_CORE);
+  xTaskCreatePinnedToCore(controlTask, controlLoad.name, 4096, NULL, CONTROL_PRIORITY, &controlLoad.handle, controlLoad.core);
+  xTaskCreatePinnedToCore(uiTask, uiLoad.name, 8192, NULL, UI_PRIORITY, &uiLoad.handle, uiLoad.core);
+  xTaskCreatePinnedToCore(displayTask, displayLoad.name, 4096, NULL, DISPLAY_PRIORITY, &displayLoad.handle, displayLoad.core);
+  allocCounterWatch(controlLoad.handle);
+  allocCounterWatch(uiLoad.handle);
+  allocCounterWatch(displayLoad.handle);
+
+  LOG_VERBOSELN("Exiting...");
 }
 
 void setupDisplay()
 {
-  String oldMethodName = methodName;
-  methodName = "setupDisplay()";
-  Log.verboseln("Entering...");
+  LogScope scope("setupDisplay()");
+  LOG_VERBOSELN("Entering...");
 
   Wire.begin(I2C_SDA, I2C_SCL); /// #2 Identify SDA & SLC pins for your board
   if (!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS))
   {
     /// Mode + Screen Address
-    Log.warningln("Display failed to initialize");
+    LOG_WARNINGLN("Display failed to initialize");
     return;
   }
   else
   {
-    Log.infoln("Display initializing...");
+    LOG_INFOLN("Display initializing...");
     delay(200);                  /// time for board to initialize?
     display.clearDisplay();      ///
     display.setTextColor(WHITE); ///
@@ -988,17 +1745,69 @@ void setupDisplay()
     display.setCursor(1, 25);
     display.print("Starting");
     display.display(); /// needed to actually display the message
-    Log.infoln("Display setup complete!");
+    displayFound = true;
+    LOG_INFOLN("Display setup complete!");
   }
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+  LOG_VERBOSELN("Exiting...");
 }
 
+#ifdef FLOORTHERM_BENCH
+/**
+ * Times the hot paths on the board and prints the results to the serial
+ * port, before WiFi and the tasks start. Build with [env:esp32dev-bench].
+ */
+void runBenchmarks()
+{
+  LogScope scope("runBenchmarks()");
+  LOG_VERBOSELN("Entering...");
+
+  Bench bench(&Serial);
+  bench.begin();
+  benchCore(bench);
+
+  // The mixed stream through the real callback and routes. Nothing runs
+  // the control task yet, so the zone commands it queues are dropped here.
+  const AsyncMqttClientMessageProperties props = {0, false, false};
+  bench.runEach("onMqttMessage mixed", BENCH_MQTT_OPS, [&]()
+                {
+                  static size_t next = 0;
+                  const BenchMessage &m = benchMessages[next++ % benchMessageCount];
+                  char payload[16];
+                  size_t len = strlen(m.payload);
+                  memcpy(payload, m.payload, len + 1);
+                  onMqttMessage((char *)m.topic, payload, props, len, 0, len);
+                  ZoneCommand cmd;
+                  while (zoneCommands.pop(cmd))
+                    ; });
+
+  if (displayFound)
+  {
+    // Every row heating draws the most text
+    bench.run("displayHeatingStatus render", BENCH_RENDER_OPS, []()
+              {
+                for (int r = 0; r < DISPLAY_ZONE_ROWS; r++)
+                {
+                  DisplayRow row = {(int16_t)(r % ZONE_COUNT), 71, 72, HeatingMode::Heating, (uint8_t)r};
+                  drawZoneName(r, row.zone);
+                  drawZoneValues(r, row);
+                } });
+    bench.run("displayHeatingStatus frame", BENCH_FRAME_OPS, []()
+              {
+                displayFullRedraw = true;
+                displayHeatingStatus(millis()); });
+    displayFullRedraw = true;
+  }
+  else
+    bench.skip("displayHeatingStatus", "no display");
+
+  LOG_VERBOSELN("Exiting...");
+}
+#endif
+
 void setup()
 {
-  String oldMethodName = methodName;
-  methodName = "setup()";
+  LogScope scope("setup()");
 
   preferences.begin("ACclimate", false);
 
@@ -1009,26 +1818,39 @@ void setup()
 
   delay(500);
 
-  Log.begin(logLevel, &Serial);
+  asyncLog.forward(&mqttLog);
+  asyncLog.begin(&Serial, LOG_DRAIN_PRIORITY, UI_CORE);
+  Log.begin(logLevel, &asyncLog);
   Log.setPrefix(printTimestamp);
   Log.setShowLevel(false);
+  Log.setBinary(LOG_BINARY);
 
-  Log.infoln("FloorTherm starting...");
+  LOG_INFOLN("FloorTherm starting...");
 
+  initZones();
   loadPrefs();
   // Hack to set logLevel again after getting preferences
   Log.setLevel(logLevel);
 
-  for (int i = 0; i < 5; i++)
-    pinMode(outPins[i], OUTPUT);
+  zoneRelayBegin();
+  for (size_t b = 0; b < muxSelectCount; b++)
+    pinMode(muxSelectPins[b], OUTPUT);
 
   pinMode(LED_PIN, OUTPUT);
 
-  buildCommandTopics();
+  setupTopicRoutes();
 
   setupDisplay();
 
+  setupHistory();
+
+  startSampler();
   GetTemps();
+  publishZoneState();
+
+#ifdef FLOORTHERM_BENCH
+  runBenchmarks();
+#endif
 
   mqttReconnectTimer = xTimerCreate("mqttTimer", pdMS_TO_TICKS(2000), pdFALSE, (void *)0,
                                     reinterpret_cast<TimerCallbackFunction_t>(connectToMqtt));
@@ -1050,33 +1872,13 @@ void setup()
 
   connectToWifi();
 
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
+  startTasks();
+
+  LOG_VERBOSELN("Exiting...");
 }
 
 void loop()
 {
-  String oldMethodName = methodName;
-  methodName = "loop()";
-
-  GetTemps();
-
-  SetHeatControl();
-  displayHeatingStatus();
-
-  bool anyEnabled = zoneHeatEnable[0] || zoneHeatEnable[1] || zoneHeatEnable[2] || zoneHeatEnable[3];
-  unsigned long rightNow = millis();
-
-  if (rightNow > lastStatusBroadcast + 60000)
-  {
-    publishHeatingStatus();
-    logHeatingStatus();
-    lastStatusBroadcast = millis();
-  }
-
-  ledOn = !ledOn;
-  digitalWrite(LED_PIN, ledOn);
-
-  Log.verboseln("Exiting...");
-  methodName = oldMethodName;
-}
\ No newline at end of file
+  // All work runs on the pinned control and UI tasks started in setup()
+  vTaskDelete(NULL);
+}
@@ -0,0 +1,183 @@
+#include <Arduino.h>
+#include <Logger.h>
+#include <LogScope.h>
+#include <SettingsBlob.h>
+#include "Settings.h"
+#include "Status.h"
+
+Preferences preferences;
+
+int floorthermIndex = -1;
+int logLevel = LOG_LEVEL_INFO;
+
+std::atomic<bool> prefsStorePending(false);
+
+// Everything persisted, written to NVS as one CRC-checked blob
+struct Settings
+{
+  int16_t floorthermIndex;
+  int16_t setTemp[ZONE_COUNT];
+  uint8_t heatEnable[ZONE_COUNT];
+  int8_t logLevel;
+};
+typedef SettingsBlob<Settings, PREFS_VERSION> SettingsRecord;
+
+Settings storedSettings;    /// What NVS holds now (UI task only)
+bool legacyPrefs = false;   /// Old one-key-per-field prefs still to be removed
+bool prefsDirty = false;
+unsigned long prefsFirstChange = 0;
+unsigned long prefsLastChange = 0;
+uint32_t prefsFlashWrites = 0;
+
+void collectSettings(Settings &s)
+{
+  ZoneSnapshot zs = zoneState.read();
+  memset(&s, 0, sizeof(s));
+  s.floorthermIndex = floorthermIndex;
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    s.setTemp[i] = zs.zone[i].setTemp;
+    s.heatEnable[i] = zs.zone[i].heatEnable;
+  }
+  s.logLevel = logLevel;
+}
+
+int countChangedSettings(const Settings &a, const Settings &b)
+{
+  int changed = (a.floorthermIndex != b.floorthermIndex) + (a.logLevel != b.logLevel);
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+    changed += (a.setTemp[i] != b.setTemp[i]) + (a.heatEnable[i] != b.heatEnable[i]);
+  return changed;
+}
+
+void removeLegacyPrefs()
+{
+  char key[16];
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    snprintf(key, sizeof(key), "Z%uSetTemp", (unsigned)i);
+    preferences.remove(key);
+    snprintf(key, sizeof(key), "Z%uEnabled", (unsigned)i);
+    preferences.remove(key);
+  }
+  preferences.remove("LogLevel");
+  preferences.remove("FloorthermIndex");
+}
+
+void storePrefs()
+{
+  LogScope scope("storePrefs()");
+  LOG_VERBOSELN("Entering...");
+
+  SettingsRecord record;
+  memset(&record, 0, sizeof(record));
+  collectSettings(record.data);
+
+  int changed = countChangedSettings(record.data, storedSettings);
+  if (changed == 0)
+  {
+    LOG_VERBOSELN("Preferences unchanged, nothing to write.");
+  }
+  else
+  {
+    LOG_INFOLN("Storing Preferences (%d fields changed).", changed);
+    record.seal();
+    if (preferences.putBytes(PREFS_KEY, &record, sizeof(record)) == sizeof(record))
+    {
+      prefsFlashWrites++;
+      storedSettings = record.data;
+      if (legacyPrefs)
+      {
+        LOG_INFOLN("Removing old preference keys.");
+        removeLegacyPrefs();
+        legacyPrefs = false;
+      }
+    }
+    else
+    {
+      LOG_ERRORLN("Could not write Preferences!");
+    }
+  }
+
+  LOG_VERBOSELN("Exiting...");
+}
+
+/**
+ * Write-behind for preference changes - UI task only. A change is written
+ * once PREFS_DEBOUNCE_MS pass without another one, or PREFS_MAX_DELAY_MS
+ * after the first, so a burst of setpoint updates costs one flash write.
+ */
+void servicePrefs(unsigned long now)
+{
+  if (prefsStorePending.exchange(false))
+  {
+    if (!prefsDirty)
+      prefsFirstChange = now;
+    prefsLastChange = now;
+    prefsDirty = true;
+  }
+
+  if (prefsDirty && ((now - prefsLastChange >= PREFS_DEBOUNCE_MS) || (now - prefsFirstChange >= PREFS_MAX_DELAY_MS)))
+  {
+    storePrefs();
+    prefsDirty = false;
+  }
+}
+
+void loadLegacyPrefs()
+{
+  LOG_INFOLN("Loading zone settings.");
+  char key[16];
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    snprintf(key, sizeof(key), "Z%uSetTemp", (unsigned)i);
+    zones[i].setTemp = preferences.getInt(key, zones[i].setTemp);
+    snprintf(key, sizeof(key), "Z%uEnabled", (unsigned)i);
+    zones[i].heatEnable = preferences.getBool(key, zones[i].heatEnable);
+  }
+
+  logLevel = preferences.getInt("LogLevel", logLevel);
+
+  if (preferences.isKey("FloorthermIndex"))
+  {
+    LOG_INFOLN("Loading index.");
+    floorthermIndex = preferences.getInt("FloorthermIndex");
+  }
+}
+
+void loadPrefs()
+{
+  LogScope scope("loadPrefs()");
+  LOG_VERBOSELN("Entering...");
+
+  LOG_INFOLN("Loading Preferences.");
+
+  SettingsRecord record;
+  memset(&storedSettings, 0, sizeof(storedSettings));
+
+  if ((preferences.getBytes(PREFS_KEY, &record, sizeof(record)) == sizeof(record)) && record.valid())
+  {
+    for (size_t i = 0; i < ZONE_COUNT; i++)
+    {
+      zones[i].setTemp = record.data.setTemp[i];
+      zones[i].heatEnable = record.data.heatEnable[i];
+    }
+    logLevel = record.data.logLevel;
+    floorthermIndex = record.data.floorthermIndex;
+    storedSettings = record.data;
+  }
+  else if (preferences.isKey("Z0SetTemp"))
+  {
+    LOG_WARNINGLN("Converting old Preferences.");
+    loadLegacyPrefs();
+    legacyPrefs = true;
+    prefsStorePending = true;
+  }
+  else
+  {
+    LOG_WARNINGLN("Could not find Preferences!");
+    prefsStorePending = true;
+  }
+
+  LOG_VERBOSELN("Exiting...");
+}
@@ -0,0 +1,380 @@
+// Native simulator: runs the real sampler, GetTemps() and SetHeatControl()
+// from control.cpp against a thermal model of each floor, in simulated time.
+// Set points reach the zones the way they do on the board: as MQTT payloads
+// through the handlers in commands.cpp, queued and applied on the control
+// pass, then published to the status cache and stored by settings.cpp.
+//
+//   pio run -e native
+//   .pio/build/native/program --days 7 --setpoint 72 --setback 4
+//
+// Options (all optional):
+//   --days N        simulated days (default 7)
+//   --setpoint F    setpoint for every zone (default 72)
+//   --setback F     lower the setpoint by F from 22:00 to 06:00
+//   --ambient F     mean room temperature the floors lose heat to (default 62)
+//   --fault Z@H     zone Z's sensor reads open from hour H on
+//   --csv MIN       print a CSV line every MIN simulated minutes
+//   --seed N        ADC noise seed
+//
+// Prints a per-zone summary at the end: temperature range, time within
+// 1F of the setpoint, relay cycles and heating duty, the commands, status
+// documents and settings writes, whether the settings read back after a
+// simulated restart, plus the speed up over real time.
+
+#include <Arduino.h>
+#include <Logger.h>
+#include <NativeHal.h>
+#include <TopicRouter.h>
+#include <chrono>
+#include <random>
+#include "Control.h"
+#include "Commands.h"
+#include "Settings.h"
+#include "Status.h"
+
+// ********************* Model Parameters ************************
+#define SIM_HEAT_F_PER_H 6.0   /// Heating cable into the slab, per hour
+#define SIM_SLAB_TAU_H 0.75    /// Slab to floor surface (sensor) lag
+#define SIM_LOSS_TAU_H 10.0    /// Floor surface to room loss time constant
+#define SIM_AMBIENT_SWING_F 4  /// Day/night room temperature swing
+#define SIM_ADC_NOISE 2.0      /// ADC noise, codes RMS
+#define SIM_WARMUP_H 24        /// Hours left out of the summary while floors settle
+#define SIM_UI_PERIOD_MS 500   /// UI pass (status, settings), as UI_PERIOD_MS in main.cpp
+
+struct FloorModel
+{
+  // Double: a 10 ms step moves a floor by ~1e-6 F, below float resolution
+  double slab;    /// Temperature at the heating cable
+  double surface; /// Temperature the sensor sees
+  double heatScale;
+  double lossScale;
+};
+
+struct ZoneStats
+{
+  float minTemp;
+  float maxTemp;
+  uint32_t samples;
+  uint32_t inBand;
+  uint32_t heating;
+  uint32_t cycles;
+  bool wasHeating;
+};
+
+struct SimOptions
+{
+  double days = 7;
+  float setpoint = 72;
+  float setback = 0;
+  float ambient = 62;
+  int faultZone = -1;
+  double faultHour = 0;
+  double csvMinutes = 0;
+  unsigned seed = 1;
+};
+
+static FloorModel floors[ZONE_COUNT];
+static ZoneStats stats[ZONE_COUNT];
+static bool sensorOpen[ZONE_COUNT];
+static uint16_t openCode = 0;
+static float codeTemp[4096]; /// ConvertValToTemp() for every ADC code
+static bool codeRising;      /// Temperature rises with the code
+static std::mt19937 rng;
+static std::normal_distribution<float> adcNoise(0, SIM_ADC_NOISE);
+
+static void printSimTime(Print *out, int level)
+{
+  char t[24];
+  unsigned long s = millis() / 1000;
+  snprintf(t, sizeof(t), "%3lud %02lu:%02lu:%02lu ", s / 86400, s / 3600 % 24, s / 60 % 60, s % 60);
+  out->print(t);
+}
+
+static void buildCodeTable()
+{
+  for (int code = 0; code < 4096; code++)
+  {
+    codeTemp[code] = ConvertValToTemp(code);
+    if (codeTemp[code] == thermistor::kSensorOpen)
+      openCode = code;
+  }
+  codeRising = ConvertValToTemp(3000) > ConvertValToTemp(1000);
+}
+
+static uint16_t tempToCode(float temp)
+{
+  // Binary search over the valid part of the table
+  int lo = 0;
+  int hi = 4095;
+  while (lo < hi)
+  {
+    int mid = (lo + hi) / 2;
+    float t = codeTemp[mid];
+    bool below = thermistor::isSensorFault(t) ? (mid < 2048) == codeRising : (t < temp) == codeRising;
+    if (below)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static uint16_t simAnalogRead(uint8_t pin)
+{
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    const ZoneDef &def = zoneTable.def[i];
+    if (def.inPin != pin)
+      continue;
+    if (def.muxChannel >= 0)
+    {
+      int channel = 0;
+      for (size_t b = 0; b < muxSelectCount; b++)
+        channel |= hal::pinLevel(muxSelectPins[b]) << b;
+      if (channel != def.muxChannel)
+        continue;
+    }
+
+    if (sensorOpen[i])
+      return openCode;
+    int code = tempToCode(floors[i].surface) + lroundf(adcNoise(rng));
+    return constrain(code, 0, 4095);
+  }
+  return 0;
+}
+
+static void stepFloors(double hours, double ambient)
+{
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    FloorModel &f = floors[i];
+    bool on = hal::pinLevel(zoneTable.def[i].outPin);
+    double toSurface = (f.slab - f.surface) / SIM_SLAB_TAU_H;
+    double loss = (f.surface - ambient) / (SIM_LOSS_TAU_H * f.lossScale);
+    f.slab += hours * ((on ? SIM_HEAT_F_PER_H * f.heatScale : 0) - toSurface);
+    f.surface += hours * (toSurface - loss);
+  }
+}
+
+static void recordStats(float setpoint)
+{
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    ZoneStats &s = stats[i];
+    bool on = hal::pinLevel(zoneTable.def[i].outPin);
+    s.minTemp = fminf(s.minTemp, floors[i].surface);
+    s.maxTemp = fmaxf(s.maxTemp, floors[i].surface);
+    s.samples++;
+    s.inBand += fabsf(floors[i].surface - setpoint) <= 1.0f;
+    s.heating += on;
+    s.cycles += on && !s.wasHeating;
+    s.wasHeating = on;
+  }
+}
+
+static uint32_t commandsSent = 0;
+static uint32_t statusDocs = 0;
+
+// One message per zone on its /set or /enable topic, as a dashboard sends
+static void sendZoneMessages(TopicHandler handler, const TopicString *topics, int value)
+{
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    char payload[8];
+    size_t len = snprintf(payload, sizeof(payload), "%d", value);
+    handler(topics[i].c_str(), payload, len, i);
+    commandsSent++;
+  }
+}
+
+// Every zone in one message on the bulk topic, as a schedule sends
+static void sendBulkSetpoint(int16_t setTemp)
+{
+  char payload[ZONE_COUNT * 32 + 2];
+  size_t len = 0;
+  payload[len++] = '{';
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+    len += snprintf(payload + len, sizeof(payload) - len, "%s\"%s\":{\"SetTemp\":%d}", i ? "," : "",
+                    zoneTable.name(i), setTemp);
+  len += snprintf(payload + len, sizeof(payload) - len, "}");
+  onZonesSetMessage("floortherm/zones/set", payload, len, 0);
+  commandsSent++;
+}
+
+// What the UI task does with the flags the control pass raises
+static void uiPass()
+{
+  bool status = statusPublishPending.exchange(false);
+  status |= bulkStatusPending.exchange(false);
+  if (status)
+  {
+    size_t len;
+    cachedStatusJson(len);
+    statusDocs++;
+  }
+  servicePrefs(millis());
+}
+
+// Stores what is pending, then reads the settings back as a reboot would
+static bool settingsSurviveRestart()
+{
+  servicePrefs(millis() + PREFS_MAX_DELAY_MS);
+
+  ZoneState applied[ZONE_COUNT];
+  memcpy(applied, zones, sizeof(zones));
+  initZones();
+  preferences.end();
+  preferences.begin("ACclimate", false);
+  loadPrefs();
+
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+    if ((zones[i].setTemp != applied[i].setTemp) || (zones[i].heatEnable != applied[i].heatEnable))
+      return false;
+  return true;
+}
+
+static bool parseOptions(int argc, char **argv, SimOptions &o)
+{
+  for (int a = 1; a < argc; a += 2)
+  {
+    const char *opt = argv[a];
+    const char *val = (a + 1 < argc) ? argv[a + 1] : NULL;
+    if (val == NULL)
+      return false;
+    if (!strcmp(opt, "--days"))
+      o.days = atof(val);
+    else if (!strcmp(opt, "--setpoint"))
+      o.setpoint = atof(val);
+    else if (!strcmp(opt, "--setback"))
+      o.setback = atof(val);
+    else if (!strcmp(opt, "--ambient"))
+      o.ambient = atof(val);
+    else if (!strcmp(opt, "--csv"))
+      o.csvMinutes = atof(val);
+    else if (!strcmp(opt, "--seed"))
+      o.seed = atoi(val);
+    else if (!strcmp(opt, "--fault") && (sscanf(val, "%d@%lf", &o.faultZone, &o.faultHour) == 2))
+      ;
+    else
+      return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  SimOptions opt;
+  if (!parseOptions(argc, argv, opt))
+  {
+    fprintf(stderr, "usage: %s [--days N] [--setpoint F] [--setback F] [--ambient F] [--fault Z@H] [--csv MIN] [--seed N]\n", argv[0]);
+    return 2;
+  }
+
+  Log.begin(LOG_LEVEL_WARNING, &Serial);
+  Log.setPrefix(printSimTime);
+  Log.setShowLevel(false);
+
+  rng.seed(opt.seed);
+  hal::setAnalogSource(simAnalogRead);
+  buildCodeTable();
+
+  initZones();
+  preferences.begin("ACclimate", false);
+  loadPrefs();
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    // Rooms differ a little, so the zones don't cycle in lock step
+    floors[i] = {opt.ambient, opt.ambient, 1.0 - 0.05 * i, 1.0 + 0.1 * i};
+    stats[i] = {INFINITY, -INFINITY, 0, 0, 0, 0, false};
+  }
+  sendZoneMessages(onEnableMessage, zoneTable.enableTopic, 1);
+  sendZoneMessages(onSetPointMessage, zoneTable.setPointTopic, lroundf(opt.setpoint));
+  int16_t setTemp = lroundf(opt.setpoint);
+
+  // Prime the sampler like startSampler() does
+  for (int n = 0; n < SAMPLE_DEPTH; n++)
+    sampleZones();
+
+  if (opt.csvMinutes > 0)
+  {
+    printf("hours");
+    for (size_t i = 0; i < ZONE_COUNT; i++)
+      printf(",%s,%s_set,%s_heat", zoneTable.name(i), zoneTable.name(i), zoneTable.name(i));
+    printf("\n");
+  }
+
+  const uint64_t samplePeriodUs = SAMPLE_PERIOD_MS * 1000ULL;
+  const uint32_t samplesPerControl = CONTROL_PERIOD_MS / SAMPLE_PERIOD_MS;
+  const uint32_t samplesPerUi = SIM_UI_PERIOD_MS / SAMPLE_PERIOD_MS;
+  const uint64_t csvEvery = (uint64_t)(opt.csvMinutes * 60e6 / samplePeriodUs);
+  const uint64_t steps = (uint64_t)(opt.days * 86400e6 / samplePeriodUs);
+  const uint64_t warmupSteps = (uint64_t)(SIM_WARMUP_H * 3600e6 / samplePeriodUs);
+
+  auto wallStart = std::chrono::steady_clock::now();
+  uint64_t controlPasses = 0;
+  for (uint64_t step = 0; step < steps; step++)
+  {
+    uint64_t due = (step + 1) * samplePeriodUs;
+    double hour = hal::nowMicros() / 3600e6;
+
+    if ((opt.faultZone >= 0) && (opt.faultZone < (int)ZONE_COUNT))
+      sensorOpen[opt.faultZone] = hour >= opt.faultHour;
+
+    sampleZones();
+    if (step % samplesPerControl == 0)
+    {
+      double hourOfDay = fmod(hour, 24.0);
+      bool night = (hourOfDay >= 22) || (hourOfDay < 6);
+      int16_t target = lroundf(opt.setpoint - (night ? opt.setback : 0));
+      if (target != setTemp)
+      {
+        sendBulkSetpoint(target);
+        setTemp = target;
+      }
+
+      // As controlTask() runs them
+      applyZoneCommands();
+      GetTemps();
+      SetHeatControl();
+      publishZoneState();
+      controlPasses++;
+    }
+    if (step % samplesPerUi == 0)
+      uiPass();
+
+    double ambient = opt.ambient + SIM_AMBIENT_SWING_F / 2.0 * sin(2 * M_PI * (hour - 9) / 24);
+    stepFloors(samplePeriodUs / 3600e6, ambient);
+    if (step >= warmupSteps)
+      recordStats(zones[0].setTemp);
+
+    if (csvEvery && (step % csvEvery == 0))
+    {
+      printf("%.3f", hour);
+      for (size_t i = 0; i < ZONE_COUNT; i++)
+        printf(",%.2f,%d,%d", floors[i].surface, zones[i].setTemp, hal::pinLevel(zoneTable.def[i].outPin));
+      printf("\n");
+    }
+
+    // sampleZones() already spent the mux settling time
+    if (hal::nowMicros() < due)
+      hal::advanceMicros(due - hal::nowMicros());
+  }
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  fprintf(stderr, "\nzone     min F   max F  in band  cycles   duty\n");
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    const ZoneStats &s = stats[i];
+    float n = s.samples ? s.samples : 1;
+    fprintf(stderr, "%-6s %7.2f %7.2f %7.1f%% %7u %5.1f%%\n", zoneTable.name(i), s.minTemp, s.maxTemp,
+            100 * s.inBand / n, s.cycles, 100 * s.heating / n);
+  }
+  bool reloaded = settingsSurviveRestart();
+  fprintf(stderr, "\n%u zone commands, %u status documents, %u settings writes, settings %s after restart\n",
+          commandsSent, statusDocs, prefsFlashWrites, reloaded ? "restored" : "LOST");
+
+  double simS = hal::nowMicros() / 1e6;
+  fprintf(stderr, "\n%.1f days, %llu control passes in %.2f s wall time (%.0fx real time)\n",
+          simS / 86400, (unsigned long long)controlPasses, wallS, simS / wallS);
+  return reloaded ? 0 : 1;
+}
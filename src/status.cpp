@@ -0,0 +1,100 @@
+#include <Arduino.h>
+#include <Logger.h>
+#include <LogScope.h>
+#include <ArduinoJson.h>
+#include "Status.h"
+
+const int docCapacity = JSON_OBJECT_SIZE(ZONE_COUNT) + ZONE_COUNT * JSON_OBJECT_SIZE(4);
+const int roomDocCapacity = JSON_OBJECT_SIZE(4);
+
+SeqLock<ZoneSnapshot> zoneState;
+ZoneSnapshot zoneStateWritten; /// Last snapshot put in zoneState (control task only)
+bool zoneStateWrittenValid = false;
+
+// Serialized status, rebuilt only when the zone state version moves on.
+// Only the UI task touches it.
+char statusJson[STATUS_JSON_MAX];
+size_t statusJsonLen = 0;
+uint32_t statusJsonVersion = 0;
+ZoneSnapshot statusJsonState; /// Zone state statusJson was built from
+bool statusJsonValid = false;
+
+/**
+ * Publishes zones[] to the other tasks. A pass that changed nothing leaves
+ * the version where it was, so the status JSON cache and the display only
+ * redo work when a reading or setting really moved. Control task only.
+ */
+void publishZoneState()
+{
+  ZoneSnapshot zs;
+  memcpy(zs.zone, zones, sizeof(zones));
+  if (zoneStateWrittenValid && (memcmp(&zs, &zoneStateWritten, sizeof(zs)) == 0))
+    return;
+
+  zoneState.write(zs);
+  zoneStateWritten = zs;
+  zoneStateWrittenValid = true;
+}
+
+size_t getRoomStatusJson(const ZoneState &zone, char *buf, size_t size)
+{
+  LogScope scope("getRoomStatusJson()");
+  LOG_VERBOSELN("Entering...");
+
+  StaticJsonDocument<roomDocCapacity> doc;
+
+  doc["CurrentTemp"] = zone.actualTemp;
+  doc["Enabled"] = zone.heatEnable;
+  doc["SetTemp"] = zone.setTemp;
+  doc["Heating"] = zone.heating;
+
+  LOG_VERBOSELN("Serializing Room Status JSON");
+  size_t len = serializeJson(doc, buf, size);
+  if (measureJson(doc) >= size)
+    LOG_ERRORLN("Room status JSON truncated to %d bytes", (int)len);
+
+  LOG_VERBOSELN("Exiting...");
+  return len;
+}
+
+size_t getStatusJson(const ZoneSnapshot &zs, char *buf, size_t size)
+{
+  LogScope scope("getStatusJson()");
+  LOG_VERBOSELN("Entering...");
+
+  StaticJsonDocument<docCapacity> doc;
+
+  for (size_t i = 0; i < ZONE_COUNT; i++)
+  {
+    JsonObject room = doc.createNestedObject(zoneTable.name(i));
+    room["CurrentTemp"] = zs.zone[i].actualTemp;
+    room["Enabled"] = zs.zone[i].heatEnable;
+    room["SetTemp"] = zs.zone[i].setTemp;
+    room["Heating"] = zs.zone[i].heating;
+  }
+
+  LOG_INFOLN("Serializing Status JSON");
+  size_t len = serializeJson(doc, buf, size);
+  if (measureJson(doc) >= size)
+    LOG_ERRORLN("Status JSON truncated to %d bytes", (int)len);
+
+  LOG_VERBOSELN("Exiting...");
+  return len;
+}
+
+/**
+ * Returns the status JSON for the current zone state, serializing it only
+ * if the state has changed since the last call. UI task only.
+ */
+const char *cachedStatusJson(size_t &len)
+{
+  uint32_t version = zoneState.version();
+  if (!statusJsonValid || (version != statusJsonVersion))
+  {
+    statusJsonVersion = zoneState.read(statusJsonState);
+    statusJsonLen = getStatusJson(statusJsonState, statusJson, sizeof(statusJson));
+    statusJsonValid = true;
+  }
+  len = statusJsonLen;
+  return statusJson;
+}
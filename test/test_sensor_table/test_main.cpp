@@ -0,0 +1,77 @@
+// The generated sensor table, through the lookup the firmware runs, against
+// every point of the Honeywell chart it was built from:
+//
+//   pio test -e native
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <SensorChartTable.h>
+
+#define CHART_TOLERANCE_F 0.25 /// As MAX_CHART_ERROR_F in scripts/gen_sensor_table.py
+
+using thermistor::honeywell::chart;
+using thermistor::honeywell::table;
+
+void setUp() {}
+void tearDown() {}
+
+static double chartTempF(const thermistor::ChartPoint &p)
+{
+  return p.tempC * 9.0 / 5.0 + 32.0;
+}
+
+// A chart point lands between two ADC codes; the firmware only ever sees
+// whole codes, so read both and place the point between them
+static void test_every_chart_point()
+{
+  const double codes = table.Codes;
+  for (const thermistor::ChartPoint &p : chart)
+  {
+    double code = codes * p.ohms / (p.ohms + thermistor::honeywell::Rref);
+    uint32_t below = (uint32_t)code;
+    TEST_ASSERT_TRUE(below >= table.firstValid);
+    TEST_ASSERT_TRUE(below + 1 <= table.lastValid);
+
+    float a = table.lookup(below);
+    float b = table.lookup(below + 1);
+    double temp = a + (b - a) * (code - below);
+
+    char where[48];
+    snprintf(where, sizeof(where), "%.0f C, %.0f ohms, code %.2f", p.tempC, p.ohms, code);
+    TEST_ASSERT_FLOAT_WITHIN_MESSAGE(CHART_TOLERANCE_F, chartTempF(p), temp, where);
+  }
+}
+
+// The chart runs from hot (low codes) to cold, so the table must too
+static void test_table_falls_with_code()
+{
+  for (uint32_t code = table.firstValid; code < table.lastValid; code++)
+    TEST_ASSERT_TRUE(table.lookup(code + 1) < table.lookup(code));
+}
+
+static void test_sentinel_edges()
+{
+  TEST_ASSERT_EQUAL_FLOAT(thermistor::kSensorShorted, table.lookup(0));
+  TEST_ASSERT_EQUAL_FLOAT(thermistor::kSensorShorted, table.lookup(table.firstValid - 1));
+  TEST_ASSERT_EQUAL_FLOAT(thermistor::kSensorOpen, table.lookup(table.lastValid + 1));
+  TEST_ASSERT_EQUAL_FLOAT(thermistor::kSensorOpen, table.lookup(table.Codes - 1));
+
+  // The first and last valid codes interpolate against real entries, not
+  // against a neighbouring sentinel
+  float hottest = table.lookup(table.firstValid);
+  float coldest = table.lookup(table.lastValid);
+  TEST_ASSERT_FALSE(thermistor::isSensorFault(hottest));
+  TEST_ASSERT_FALSE(thermistor::isSensorFault(coldest));
+  TEST_ASSERT_TRUE(hottest > chartTempF(chart[sizeof(chart) / sizeof(chart[0]) - 1]));
+  TEST_ASSERT_TRUE(coldest < chartTempF(chart[0]));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_every_chart_point);
+  RUN_TEST(test_table_falls_with_code);
+  RUN_TEST(test_sentinel_edges);
+  return UNITY_END();
+}
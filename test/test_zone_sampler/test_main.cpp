@@ -0,0 +1,96 @@
+// ZoneSampler filter output and ring wraparound, on the host:
+//
+//   pio test -e native
+
+#include <unity.h>
+#include <ZoneSampler.h>
+
+void setUp() {}
+void tearDown() {}
+
+static void test_first_sample_primes_the_average()
+{
+  ZoneSampler<2, 4> s;
+  TEST_ASSERT_FALSE(s.primed());
+
+  s.push(0, 1000);
+  TEST_ASSERT_EQUAL_UINT16(1000, s.filtered(0));
+  TEST_ASSERT_EQUAL_UINT32(1, s.sampleCount(0));
+  TEST_ASSERT_FALSE(s.primed());
+
+  s.push(1, 2000);
+  TEST_ASSERT_TRUE(s.primed());
+  TEST_ASSERT_EQUAL_UINT16(1000, s.filtered(0));
+  TEST_ASSERT_EQUAL_UINT16(2000, s.filtered(1));
+}
+
+static void test_moving_average_steps_to_a_new_level()
+{
+  ZoneSampler<1, 4> s;
+  s.push(0, 100);
+
+  // Each new sample replaces one of the four primed ones
+  const uint16_t expected[] = {125, 150, 175, 200, 200};
+  for (uint16_t e : expected)
+  {
+    s.push(0, 200);
+    TEST_ASSERT_EQUAL_UINT16(e, s.filtered(0));
+  }
+}
+
+static void test_ring_wraps_and_averages_the_last_depth_samples()
+{
+  const size_t depth = 5;
+  ZoneSampler<1, depth> s;
+  uint16_t pushed[64];
+
+  for (size_t n = 0; n < 64; n++)
+  {
+    pushed[n] = (uint16_t)(n * 37 % 4096);
+    s.push(0, pushed[n]);
+
+    // The primed copies of the first sample count until they are replaced
+    uint32_t sum = 0;
+    for (size_t k = 0; k < depth; k++)
+      sum += (n >= k) ? pushed[n - k] : pushed[0];
+    TEST_ASSERT_EQUAL_UINT16(sum / depth, s.filtered(0));
+  }
+  TEST_ASSERT_EQUAL_UINT32(64, s.sampleCount(0));
+}
+
+static void test_zones_are_filtered_independently()
+{
+  ZoneSampler<3, 8> s;
+  for (int n = 0; n < 20; n++)
+  {
+    s.push(0, 4095);
+    s.push(2, n & 1 ? 100 : 300);
+  }
+  s.push(1, 0);
+
+  TEST_ASSERT_EQUAL_UINT16(4095, s.filtered(0));
+  TEST_ASSERT_EQUAL_UINT16(0, s.filtered(1));
+  TEST_ASSERT_EQUAL_UINT16(200, s.filtered(2));
+  TEST_ASSERT_EQUAL_UINT32(20, s.sampleCount(0));
+  TEST_ASSERT_EQUAL_UINT32(1, s.sampleCount(1));
+}
+
+static void test_full_scale_at_the_largest_depth()
+{
+  // 255 samples of 4095 must not overflow the running sum
+  ZoneSampler<1, 255> s;
+  for (int n = 0; n < 600; n++)
+    s.push(0, 4095);
+  TEST_ASSERT_EQUAL_UINT16(4095, s.filtered(0));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_first_sample_primes_the_average);
+  RUN_TEST(test_moving_average_steps_to_a_new_level);
+  RUN_TEST(test_ring_wraps_and_averages_the_last_depth_samples);
+  RUN_TEST(test_zones_are_filtered_independently);
+  RUN_TEST(test_full_scale_at_the_largest_depth);
+  return UNITY_END();
+}